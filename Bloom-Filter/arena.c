@@ -0,0 +1,109 @@
+/*
+ * This is a free software and provides no guarantee of any kind.
+ * The distribution and changes to the software is as provided by the LICENSE.
+ * View the LICENSE file in github.com/sumefsp/LPM-Algorithms-Linux-XIA and
+ * any usage of code from this file must include this declaration.
+ *
+ * 2015, LPM Algorithms for Linux XIA
+ * Garnaik Sumeet, Michel Machado
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include "arena.h"
+
+#ifdef MAP_HUGE_2MB
+#define ARENA_MAPHUGE (MAP_HUGETLB | MAP_HUGE_2MB)
+#else
+#define ARENA_MAPHUGE MAP_HUGETLB
+#endif
+
+/*
+ * Map size bytes of small pages starting at a multiple of ARENA_HUGEPAGE, so
+ * that transparent huge pages can back all of it
+ */
+static char *mapaligned(size_t size)
+{
+	char *map, *base;
+	size_t head;
+
+	map = mmap(NULL, size + ARENA_HUGEPAGE, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (MAP_FAILED == map)
+		return NULL;
+	head = -(uintptr_t) map & (ARENA_HUGEPAGE - 1);
+	base = map + head;
+	if (head > 0)
+		munmap(map, head);
+	munmap(base + size, ARENA_HUGEPAGE - head);
+	return base;
+}
+
+/*
+ * Create an arena of at least bytes bytes, backed by huge pages if the host
+ * has any to spare, or NULL if it cannot be mapped
+ */
+struct bloom_arena *bloom_arena_create(size_t bytes)
+{
+	struct bloom_arena *a;
+
+	if ((a = malloc(sizeof(struct bloom_arena))) == NULL)
+		return NULL;
+	a->size = (bytes + ARENA_HUGEPAGE - 1) & ~(ARENA_HUGEPAGE - 1);
+	if (0 == a->size)
+		a->size = ARENA_HUGEPAGE;
+	a->used = 0;
+
+	// Pages reserved for huge page mappings first, as they cannot be
+	// split, and then small pages that the kernel may merge
+	a->base = mmap(NULL, a->size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | ARENA_MAPHUGE, -1, 0);
+	if (a->base != MAP_FAILED) {
+		a->pages = ARENA_HUGETLB;
+		return a;
+	}
+	if ((a->base = mapaligned(a->size)) == NULL) {
+		free(a);
+		return NULL;
+	}
+	a->pages = ARENA_SMALLPAGES;
+#ifdef MADV_HUGEPAGE
+	if (0 == madvise(a->base, a->size, MADV_HUGEPAGE))
+		a->pages = ARENA_THP;
+#endif
+	return a;
+}
+
+void bloom_arena_destroy(struct bloom_arena *a)
+{
+	if (a != NULL) {
+		munmap(a->base, a->size);
+		free(a);
+	}
+}
+
+/*
+ * Return bytes zeroed bytes aligned to ARENA_ALIGN, or NULL if a is NULL or
+ * has no room left
+ */
+void *bloom_arena_alloc(struct bloom_arena *a, size_t bytes)
+{
+	size_t off;
+
+	if (NULL == a)
+		return NULL;
+	off = (a->used + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+	if (off > a->size || bytes > a->size - off)
+		return NULL;
+	a->used = off + bytes;
+	return a->base + off;
+}
+
+/* Return whether p was allocated from a */
+int bloom_arena_owns(const struct bloom_arena *a, const void *p)
+{
+	return a != NULL && (const char *) p >= a->base &&
+		(const char *) p < a->base + a->size;
+}
@@ -0,0 +1,42 @@
+/*
+ * This is a free software and provides no guarantee of any kind.
+ * The distribution and changes to the software is as provided by the LICENSE.
+ * View the LICENSE file in github.com/sumefsp/LPM-Algorithms-Linux-XIA and
+ * any usage of code from this file must include this declaration.
+ *
+ * 2015, LPM Algorithms for Linux XIA
+ * Garnaik Sumeet, Michel Machado
+ *
+ * One mapping that the filters and the tables of a bloom_structure are
+ * carved from, so that a lookup that probes dozens of them goes through a few
+ * huge pages instead of a page of every one. Memory is handed out in order
+ * and only given back when the arena is destroyed; an allocation that does
+ * not fit returns NULL and the caller falls back to its own memory.
+ */
+#ifndef _BLOOM_ARENA_H_
+#define _BLOOM_ARENA_H_
+
+#include <stddef.h>
+
+#define ARENA_ALIGN 64			/* alignment of every allocation */
+#define ARENA_HUGEPAGE (2UL << 20)	/* size and alignment of the mapping */
+
+/* How the arena is backed */
+#define ARENA_SMALLPAGES 0
+#define ARENA_HUGETLB 1		/* MAP_HUGETLB */
+#define ARENA_THP 2		/* transparent huge pages, by madvise() */
+
+struct bloom_arena
+{
+	char *base;
+	size_t size;
+	size_t used;
+	int pages;		//ARENA_*
+};
+
+struct bloom_arena *bloom_arena_create(size_t bytes);
+void bloom_arena_destroy(struct bloom_arena *a);
+void *bloom_arena_alloc(struct bloom_arena *a, size_t bytes);
+int bloom_arena_owns(const struct bloom_arena *a, const void *p);
+
+#endif
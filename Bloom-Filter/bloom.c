@@ -41,7 +41,9 @@
 
 void free_bitmap(bitmap_t *bitmap)
 {
-	if ((munmap(bitmap->array, bitmap->bytes)) < 0) {
+	/* an arena is unmapped as a whole */
+	if (bitmap->arena == NULL &&
+			(munmap(bitmap->array, bitmap->bytes)) < 0) {
 		perror("Error, unmapping memory");
 	}
 	free(bitmap);
@@ -49,6 +51,16 @@ void free_bitmap(bitmap_t *bitmap)
 
 bitmap_t *bitmap_resize(bitmap_t *bitmap, size_t old_size, size_t new_size)
 {
+	char *old = bitmap->array;
+
+	/* an array in an arena moves to a new mmap of its own */
+	if (bitmap->arena != NULL) {
+		bitmap->arena = NULL;
+		bitmap->array = NULL;
+	} else {
+		old = NULL;
+	}
+
 	/* resize if mmap exists else new mmap */
 	if (bitmap->array != NULL) {
 		bitmap->array = mremap(bitmap->array, old_size, new_size,
@@ -68,6 +80,9 @@ bitmap_t *bitmap_resize(bitmap_t *bitmap, size_t old_size, size_t new_size)
 			free_bitmap(bitmap);
 			return NULL;
 		}
+		if (old != NULL)
+			memcpy(bitmap->array, old, old_size < new_size ?
+					old_size : new_size);
 	}
 
 	bitmap->bytes = new_size;
@@ -88,6 +103,7 @@ bitmap_t *new_bitmap(size_t bytes)
 
 	bitmap->bytes = bytes;
 	bitmap->array = NULL;
+	bitmap->arena = NULL;
 
 	if ((bitmap = bitmap_resize(bitmap, 0, bytes)) == NULL) {
 		return NULL;
@@ -96,6 +112,26 @@ bitmap_t *new_bitmap(size_t bytes)
 	return bitmap;
 }
 
+/*
+ * Same as new_bitmap(), with the array taken from arena if it has room
+ */
+bitmap_t *new_bitmap_arena(size_t bytes, struct bloom_arena *arena)
+{
+	bitmap_t *bitmap;
+	char *array;
+
+	if ((array = bloom_arena_alloc(arena, bytes)) == NULL)
+		return new_bitmap(bytes);
+	if ((bitmap = (bitmap_t *)malloc(sizeof(bitmap_t))) == NULL) {
+		return NULL;
+	}
+
+	bitmap->bytes = bytes;
+	bitmap->array = array;
+	bitmap->arena = arena;
+	return bitmap;
+}
+
 int bitmap_increment(bitmap_t *bitmap, unsigned int index, long offset)
 {
 	long access = index / 2 + offset;
@@ -181,7 +217,7 @@ int free_counting_bloom(counting_bloom_t *bloom)
 	if (bloom != NULL) {
 		free(bloom->hashes);
 		bloom->hashes = NULL;
-		free(bloom->bitmap);
+		free_bitmap(bloom->bitmap);
 		free(bloom);
 		bloom = NULL;
 	}
@@ -204,7 +240,9 @@ counting_bloom_t *counting_bloom_init(unsigned int capacity,
 	bloom->nfuncs = (int) ceil(log(1 / error_rate) / log(2));
 	bloom->counts_per_func = (int) ceil(capacity * fabs(log(error_rate)) /
 			(bloom->nfuncs * pow(log(2), 2)));
-	bloom->size = bloom->nfuncs * bloom->counts_per_func;
+	/* whole blocks, so that the hashes can use the blocked layout */
+	bloom->size = (bloom->nfuncs * bloom->counts_per_func +
+			BLOOM_BLOCKBITS - 1) / BLOOM_BLOCKBITS * BLOOM_BLOCKBITS;
 	/* rounding-up integer divide by 2 of bloom->size */
 	bloom->num_bytes = ((bloom->size + 1) / 2) +
 				sizeof(counting_bloom_header_t);
@@ -214,16 +252,35 @@ counting_bloom_t *counting_bloom_init(unsigned int capacity,
 }
 
 counting_bloom_t *new_counting_bloom(unsigned int capacity, double error_rate)
+{
+	return new_counting_bloom_arena(capacity, error_rate, NULL);
+}
+
+counting_bloom_t *new_counting_bloom_arena(unsigned int capacity,
+		double error_rate, struct bloom_arena *arena)
 {
 	counting_bloom_t *cur_bloom;
 
 	cur_bloom = counting_bloom_init(capacity, error_rate, 0);
-	cur_bloom->bitmap = new_bitmap(cur_bloom->num_bytes);
+	cur_bloom->bitmap = new_bitmap_arena(cur_bloom->num_bytes, arena);
 	cur_bloom->header = (counting_bloom_header_t *)
 				(cur_bloom->bitmap->array);
 	return cur_bloom;
 }
 
+/*
+ * Return the bytes that a filter and its blocked filter take from an arena
+ */
+size_t counting_bloom_footprint(unsigned int capacity, double error_rate)
+{
+	counting_bloom_t *bloom = counting_bloom_init(capacity, error_rate, 0);
+	size_t bytes = bloom->num_bytes + bloom->size / 8 + 2 * ARENA_ALIGN;
+
+	free(bloom->hashes);
+	free(bloom);
+	return bytes;
+}
+
 int counting_bloom_add(counting_bloom_t *bloom, const char *s, size_t len)
 {
 	unsigned int index, i, offset;
@@ -274,3 +331,113 @@ int counting_bloom_check(counting_bloom_t *bloom, const char *s, size_t len)
 
 	return 1;
 }
+
+/* Index of the counter of bit i of a key in the blocked layout */
+static inline unsigned int blocked_index(const counting_bloom_t *bloom,
+		const bloom_hash_t *h, unsigned int i)
+{
+	return bloom_block(h, bloom->size / BLOOM_BLOCKBITS) *
+		BLOOM_BLOCKBITS + bloom_block_bit(h, i);
+}
+
+int counting_bloom_add_hash(counting_bloom_t *bloom, const bloom_hash_t *h)
+{
+	unsigned int i;
+
+	for (i = 0; i < bloom->nfuncs; i++)
+		bitmap_increment(bloom->bitmap, blocked_index(bloom, h, i),
+				bloom->offset);
+	bloom->header->count++;
+
+	return 0;
+}
+
+int counting_bloom_remove_hash(counting_bloom_t *bloom, const bloom_hash_t *h)
+{
+	unsigned int i;
+
+	for (i = 0; i < bloom->nfuncs; i++)
+		bitmap_decrement(bloom->bitmap, blocked_index(bloom, h, i),
+				bloom->offset);
+	bloom->header->count--;
+
+	return 0;
+}
+
+/*
+ * Unlike counting_bloom_check(), this does not write to the filter, so
+ * lookups can share it
+ */
+int counting_bloom_check_hash(const counting_bloom_t *bloom,
+		const bloom_hash_t *h)
+{
+	unsigned int i;
+
+	for (i = 0; i < bloom->nfuncs; i++) {
+		if (!(bitmap_check(bloom->bitmap, blocked_index(bloom, h, i),
+						bloom->offset)))
+			return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Create the blocked filter of the counters of bloom that are not zero. bloom
+ * must only have been used with hashes.
+ */
+blocked_bloom_t *new_blocked_bloom(const counting_bloom_t *bloom,
+		struct bloom_arena *arena)
+{
+	blocked_bloom_t *blocked;
+	unsigned int i;
+
+	if ((blocked = malloc(sizeof(blocked_bloom_t))) == NULL)
+		return NULL;
+	blocked->nblocks = bloom->size / BLOOM_BLOCKBITS;
+	blocked->nfuncs = bloom->nfuncs;
+	blocked->arena = arena;
+	blocked->line = bloom_arena_alloc(arena,
+			(size_t) blocked->nblocks * 64);
+	if (blocked->line == NULL && posix_memalign((void **) &blocked->line,
+				64, (size_t) blocked->nblocks * 64)) {
+		free(blocked);
+		return NULL;
+	}
+	memset(blocked->line, 0, (size_t) blocked->nblocks * 64);
+	for (i = 0; i < bloom->size; i++) {
+		if (bitmap_check(bloom->bitmap, i, bloom->offset))
+			blocked->line[i / 64] |= (uint64_t) 1 << (i % 64);
+	}
+
+	return blocked;
+}
+
+/*
+ * Update the bits of a key in the blocked filter derived from bloom after the
+ * key was added to or removed from bloom
+ */
+void blocked_bloom_sync(blocked_bloom_t *blocked,
+		const counting_bloom_t *bloom, const bloom_hash_t *h)
+{
+	unsigned int i, index;
+	uint64_t bit;
+
+	for (i = 0; i < bloom->nfuncs; i++) {
+		index = blocked_index(bloom, h, i);
+		bit = (uint64_t) 1 << (index % 64);
+		if (bitmap_check(bloom->bitmap, index, bloom->offset))
+			blocked->line[index / 64] |= bit;
+		else
+			blocked->line[index / 64] &= ~bit;
+	}
+}
+
+void free_blocked_bloom(blocked_bloom_t *blocked)
+{
+	if (blocked != NULL) {
+		if (!bloom_arena_owns(blocked->arena, blocked->line))
+			free(blocked->line);
+		free(blocked);
+	}
+}
@@ -26,14 +26,17 @@
 #define __BLOOM_H__
 #include <stdint.h>
 #include <stdlib.h>
+#include "arena.h"
 
 typedef struct {
 	size_t bytes;
 	char *array;
+	struct bloom_arena *arena;	/* NULL if array is a mapping of its own */
 } bitmap_t;
 
 bitmap_t *bitmap_resize(bitmap_t *bitmap, size_t old_size, size_t new_size);
 bitmap_t *new_bitmap(size_t bytes);
+bitmap_t *new_bitmap_arena(size_t bytes, struct bloom_arena *arena);
 
 int bitmap_increment(bitmap_t *bitmap, unsigned int index, long offset);
 int bitmap_decrement(bitmap_t *bitmap, unsigned int index, long offset);
@@ -60,10 +63,85 @@ typedef struct {
 	bitmap_t *bitmap;
 } counting_bloom_t;
 
+/*
+ * The pair of hashes a key is probed with
+ */
+typedef struct {
+	uint32_t h1;
+	uint32_t h2;
+} bloom_hash_t;
+
+/*
+ * A blocked filter keeps all the bits of a key in one block of a cache line:
+ * h1 selects the block and bit i of the key in it is (a + i * b) %
+ * BLOOM_BLOCKBITS, with a and b taken from h2 and b odd so that the bits of a
+ * key are distinct.
+ */
+#define BLOOM_BLOCKBITS 512
+#define BLOOM_BLOCKWORDS (BLOOM_BLOCKBITS / 64)
+
+static inline unsigned int bloom_block(const bloom_hash_t *h,
+		unsigned int nblocks)
+{
+	return ((uint64_t) h->h1 * nblocks) >> 32;
+}
+
+static inline unsigned int bloom_block_bit(const bloom_hash_t *h,
+		unsigned int i)
+{
+	uint32_t a = h->h2, b = (h->h2 >> 9) | 1;
+
+	return (a + i * b) % BLOOM_BLOCKBITS;
+}
+
+/*
+ * A 1-bit blocked filter derived from a counting filter, for lookups
+ */
+typedef struct {
+	uint64_t *line;
+	unsigned int nblocks;
+	unsigned int nfuncs;
+	struct bloom_arena *arena;
+} blocked_bloom_t;
+
 int free_counting_bloom(counting_bloom_t *bloom);
 counting_bloom_t *new_counting_bloom(unsigned int capacity, double error_rate);
+counting_bloom_t *new_counting_bloom_arena(unsigned int capacity,
+		double error_rate, struct bloom_arena *arena);
+size_t counting_bloom_footprint(unsigned int capacity, double error_rate);
 int counting_bloom_add(counting_bloom_t *bloom, const char *s, size_t len);
 int counting_bloom_remove(counting_bloom_t *bloom, const char *s, size_t len);
 int counting_bloom_check(counting_bloom_t *bloom, const char *s, size_t len);
 
+/*
+ * Same as above for a key whose hashes are already known. These place the
+ * counters of a key in one block, as a blocked filter does, so a filter is
+ * used either with keys or with hashes.
+ */
+int counting_bloom_add_hash(counting_bloom_t *bloom, const bloom_hash_t *h);
+int counting_bloom_remove_hash(counting_bloom_t *bloom, const bloom_hash_t *h);
+int counting_bloom_check_hash(const counting_bloom_t *bloom,
+		const bloom_hash_t *h);
+
+blocked_bloom_t *new_blocked_bloom(const counting_bloom_t *bloom,
+		struct bloom_arena *arena);
+void blocked_bloom_sync(blocked_bloom_t *blocked,
+		const counting_bloom_t *bloom, const bloom_hash_t *h);
+void free_blocked_bloom(blocked_bloom_t *blocked);
+
+static inline int blocked_bloom_check(const blocked_bloom_t *blocked,
+		const bloom_hash_t *h)
+{
+	const uint64_t *line = blocked->line +
+		(size_t) bloom_block(h, blocked->nblocks) * BLOOM_BLOCKWORDS;
+	unsigned int i, bit;
+
+	for (i = 0; i < blocked->nfuncs; i++) {
+		bit = bloom_block_bit(h, i);
+		if (!(line[bit / 64] & (uint64_t) 1 << (bit % 64)))
+			return 0;
+	}
+	return 1;
+}
+
 #endif
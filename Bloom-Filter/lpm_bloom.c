@@ -1,11 +1,151 @@
 #include "lpm_bloom.h"
+#include "../XID-Kernel/xid_kernel.h"
 
-static int comparekeys(void *key1, void *key2)
+#define PREFIXSEED 0x97c29b3aULL
+
+/*
+ * The hashes of all the prefixes of one XID.
+ *
+ * A prefix of length len is hashed as the words of the XID it covers, the
+ * last one masked, followed by len. The state after the words that a prefix
+ * covers entirely is shared by all the prefixes that cover them, so it is
+ * computed once per XID and a prefix only mixes the word where it ends.
+ *
+ * The state is mixed with one of the BLOOM_HASH_* functions, the one of the
+ * bloom_structure, since the filters and the tables of a structure have to
+ * agree on the hashes of their keys.
+ */
+struct prefix_hash
+{
+	int hash;		//BLOOM_HASH_*
+	uint64_t word[3];	//The XID as words, lo in the upper half
+	uint64_t state[3];	//The state after the first i words
+};
+
+/* Multipliers of the words and of the length for BLOOM_HASH_MULSHIFT */
+static const uint64_t mulshift_key[4] = {
+	0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL,
+	0x165667b19e3779f9ULL, 0xd6e8feb86659fd93ULL,
+};
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+#if defined(__x86_64__)
+/* The SSE4.2 crc32 instruction, which bloom_hash_supported() checks for */
+static inline uint64_t crc32c_u64(uint64_t crc, uint64_t word)
+{
+	__asm__("crc32q %1, %0" : "+r" (crc) : "rm" (word));
+	return crc;
+}
+#endif
+
+/* Mix word i of the XID into the state */
+static inline uint64_t prefix_mix(int hash, uint64_t state, uint64_t word,
+		int i)
+{
+	switch (hash) {
+#if defined(__x86_64__)
+	case BLOOM_HASH_CRC32C:
+		return crc32c_u64(state, word);
+#endif
+	case BLOOM_HASH_XXHASH:
+		// The 8-byte step of the tail of XXH64
+		word = rotl64(word * 0xc2b2ae3d27d4eb4fULL, 31) *
+			0x9e3779b185ebca87ULL;
+		return rotl64(state ^ word, 27) * 0x9e3779b185ebca87ULL +
+			0x85ebca77c2b2ae63ULL;
+	case BLOOM_HASH_MULSHIFT:
+		return state + word * mulshift_key[i];
+	default:
+		// One round of MurmurHash3_x64_128 on one half of its state
+		word *= 0x87c37b91114253d5ULL;
+		word = rotl64(word, 31);
+		word *= 0x4cf5ad432745937fULL;
+		state ^= word;
+		return rotl64(state, 27) * 5 + 0x52dce729;
+	}
+}
+
+/* Return the hash of a prefix of length len from the state after its words */
+static inline uint64_t prefix_final(int hash, uint64_t state, int len)
+{
+	switch (hash) {
+#if defined(__x86_64__)
+	case BLOOM_HASH_CRC32C:
+		// Spread the 32 bits of the CRC over the two hashes
+		return (uint64_t) (uint32_t) crc32c_u64(state, len) *
+			0x9e3779b97f4a7c15ULL;
+#endif
+	case BLOOM_HASH_XXHASH:
+		state ^= len;
+		state ^= state >> 33;
+		state *= 0xc2b2ae3d27d4eb4fULL;
+		state ^= state >> 29;
+		state *= 0x165667b19e3779f9ULL;
+		return state ^ (state >> 32);
+	case BLOOM_HASH_MULSHIFT:
+		// Only the upper bits of a multiply-shift hash are universal
+		state += (uint64_t) (len + 1) * mulshift_key[3];
+		return (state >> 32) * 0x9e3779b97f4a7c15ULL;
+	default:
+		state ^= len;
+		state ^= state >> 33;
+		state *= 0xff51afd7ed558ccdULL;
+		state ^= state >> 33;
+		state *= 0xc4ceb9fe1a85ec53ULL;
+		return state ^ (state >> 33);
+	}
+}
+
+static void prefix_hash_init(struct prefix_hash *p, const unsigned char *id,
+		int hash)
 {
-	unsigned char *k1 = (unsigned char *) key1;
-	unsigned char *k2 = (unsigned char *) key2;
+	struct xid_words w;
 
-	return memcmp(k1, k2, HEXXID);
+	xid_load(&w, (const xid *) id);
+	p->hash = hash;
+	p->word[0] = w.hi;
+	p->word[1] = w.mid;
+	p->word[2] = (uint64_t) w.lo << 32;
+	p->state[0] = PREFIXSEED;
+	p->state[1] = prefix_mix(hash, p->state[0], p->word[0], 0);
+	p->state[2] = prefix_mix(hash, p->state[1], p->word[1], 1);
+}
+
+/* Hash the prefix of length len, which is less than XID_BITS */
+static inline void prefix_hash(const struct prefix_hash *p, int len,
+		bloom_hash_t *h)
+{
+	int i = len >> 6;
+	uint64_t v;
+
+	v = prefix_mix(p->hash, p->state[i],
+			p->word[i] & _xid_topmask(len & 63), i);
+	v = prefix_final(p->hash, v, len);
+	h->h1 = v;
+	h->h2 = v >> 32;
+}
+
+/* The hash the tables use, which mixes the bits of both hashes */
+static inline uint32_t table_hash(const bloom_hash_t *h)
+{
+	return h->h1 ^ h->h2 * 0x9e3779b1;
+}
+
+/* Store the prefix of length len as the key of the hash tables */
+static void prefix_key(const struct prefix_hash *p, int len,
+		unsigned char *key)
+{
+	struct xid_words w;
+
+	w.hi = p->word[0];
+	w.mid = p->word[1];
+	w.lo = p->word[2] >> 32;
+	xidw_mask(&w, len);
+	xid_store((xid *) key, &w);
 }
 
 static int sortbylength(const void *e1, const void *e2)
@@ -24,12 +164,30 @@ static int sortbylength(const void *e1, const void *e2)
 		return 0;
 }
 
+/*
+ * Sort the prefixes in the order of their XIDs, a prefix before the longer
+ * ones it is a prefix of
+ */
+static int sortbyprefix(const void *e1, const void *e2)
+{
+	const struct nextcreate *entry1 = (const struct nextcreate *) e1;
+	const struct nextcreate *entry2 = (const struct nextcreate *) e2;
+	int res = memcmp(entry1->prefix, entry2->prefix, HEXXID);
+
+	if (res)
+		return res;
+	return (entry1->len > entry2->len) - (entry1->len < entry2->len);
+}
+
 static int bloom_proportion(struct bloom_structure *filter,
 		struct nextcreate **tmp_table, unsigned long size)
 {
 	int j = 0;
 	int i;
 
+	// A FIB that starts empty gets its lengths from bloom_route_add()
+	if (0 == size)
+		return 0;
 	for (i = MINLENGTH; i <= MAXLENGTH; i++) {
 		if (i != tmp_table[j]->len)
 			continue;
@@ -42,11 +200,30 @@ static int bloom_proportion(struct bloom_structure *filter,
 		filter->high[i - MINLENGTH] = (j - 1);
 		filter->length[i - MINLENGTH] = j - filter->low[i - MINLENGTH];
 		filter->bloom[i - MINLENGTH] = NULL;
+		filter->blocked[i - MINLENGTH] = NULL;
 		filter->hashtable[i - MINLENGTH] = NULL;
 		filter->flag[i - MINLENGTH] = 1;
 		if (size == j)
 			break;
 	}
+	return 0;
+}
+
+/* Free the filters and the tables of a length, which then has no prefix */
+static void freelength(struct bloom_structure *filter, int i)
+{
+	free_counting_bloom(filter->bloom[i]);
+	free_blocked_bloom(filter->blocked[i]);
+	xid_table_destroy(filter->hashtable[i]);
+	xid_table_destroy(filter->marker[i]);
+	filter->bloom[i] = NULL;
+	filter->blocked[i] = NULL;
+	filter->hashtable[i] = NULL;
+	filter->marker[i] = NULL;
+	filter->length[i] = 0;
+	filter->low[i] = -1;
+	filter->high[i] = -1;
+	filter->flag[i] = 0;
 }
 
 int bloom_destroy_fib(struct bloom_structure *filter)
@@ -54,30 +231,65 @@ int bloom_destroy_fib(struct bloom_structure *filter)
 	int i;
 
 	for (i = 0; i < WDIST; i++) {
-		if (filter->flag[i]) {
-			free_counting_bloom(filter->bloom[i]);
-			hashit_destroy(filter->hashtable[i]);
-		}
+		if (filter->flag[i])
+			freelength(filter, i);
 	}
+	bloom_arena_destroy(filter->arena);
 	free(filter);
 
 	return 0;
 }
 
+/*
+ * Return whether the prefixes can be hashed with hash, one of BLOOM_HASH_*,
+ * on this host
+ */
+int bloom_hash_supported(int hash)
+{
+	switch (hash) {
+	case BLOOM_HASH_MURMUR3:
+	case BLOOM_HASH_XXHASH:
+	case BLOOM_HASH_MULSHIFT:
+		return 1;
+#if defined(__x86_64__)
+	case BLOOM_HASH_CRC32C:
+		return __builtin_cpu_supports("sse4.2");
+#endif
+	default:
+		return 0;
+	}
+}
+
 struct bloom_structure *bloom_create_fib(struct nextcreate *table,
 		unsigned long size, double error_rate)
+{
+	return bloom_create_fib_hash(table, size, error_rate, BLOOM_HASH);
+}
+
+/*
+ * Same as bloom_create_fib(), with the filters and the tables hashing the
+ * prefixes with hash, or NULL if it is not supported
+ */
+struct bloom_structure *bloom_create_fib_hash(struct nextcreate *table,
+		unsigned long size, double error_rate, int hash)
 {
 	int i, j, k, m, *next = alloca(sizeof(int));
-	unsigned char tmp[HEXXID] = {0};
 	struct nextcreate **tmp_table = NULL;
 	struct nextcreate **dup_table = NULL;
 	struct bloom_structure *filter = NULL;
-	hash_t tmp_hashmap = NULL;
+	struct xid_table *tmp_hashmap = NULL;
+	struct prefix_hash p;
+	bloom_hash_t h;
+	size_t arenasize = 0;
 
+	if (!bloom_hash_supported(hash))
+		return NULL;
 	filter = calloc(1, sizeof(struct bloom_structure));
 	assert(filter);
+	filter->hash = hash;
 	memset(filter->low, -1, WDIST * sizeof(int));
 	memset(filter->high, -1, WDIST * sizeof(int));
+	filter->error_rate = error_rate;
 
 	tmp_table = malloc(size * sizeof(struct nextcreate *));
 	dup_table = malloc(DUPS * sizeof(struct nextcreate *));
@@ -88,21 +300,55 @@ struct bloom_structure *bloom_create_fib(struct nextcreate *table,
 	qsort(tmp_table, size, sizeof(struct nextcreate *), sortbylength);
 	bloom_proportion(filter, tmp_table, size);
 
+	// One arena for the filters and the tables of every length, with room
+	// for the tables of the binary search and a quarter more for updates
+	for (i = 0; i < WDIST; i++) {
+		if (!filter->flag[i])
+			continue;
+		arenasize += counting_bloom_footprint(
+				filter->length[i] * NTIMES, error_rate);
+		arenasize += xid_table_footprint(filter->length[i]);
+		arenasize += xid_table_footprint(2 * filter->length[i]);
+	}
+	filter->arena = bloom_arena_create(arenasize + arenasize / 4);
+
 	for (i = 0; i < WDIST; i++) {
 		if (!filter->flag[i])
 			continue;
 		if (!(filter->bloom[i] =
-		new_counting_bloom(filter->length[i] * NTIMES, error_rate))) {
+		new_counting_bloom_arena(filter->length[i] * NTIMES, error_rate,
+			filter->arena))) {
 			printf("ERROR: Could not create bloom filter\n");
 			return NULL;
 		}
-		tmp_hashmap = hashit_create(filter->length[i], HEXXID, NULL, comparekeys, CHAIN_H);
+		if (!(tmp_hashmap = xid_table_create_arena(filter->length[i],
+						filter->arena))) {
+			printf("ERROR: Could not create hash table\n");
+			return NULL;
+		}
 		for (j = filter->low[i]; j <= filter->high[i]; j++) {
-			memcpy(&tmp, &(tmp_table[j]->prefix), HEXXID);
-			assert(0 == counting_bloom_add(filter->bloom[i], tmp_table[j]->prefix, HEXXID));
-			assert(0 == hashit_insert(tmp_hashmap, tmp_table[j]->prefix, &(tmp_table[j]->nexthop)));
+			// The prefixes are masked, so their hash is the one of
+			// any XID they match
+			prefix_hash_init(&p, tmp_table[j]->prefix,
+					filter->hash);
+			prefix_hash(&p, tmp_table[j]->len, &h);
+			// A duplicate only replaces the next-hop, so that
+			// deleting the route clears its counters
+			if (!xid_table_lookup(tmp_hashmap, tmp_table[j]->prefix,
+						table_hash(&h)))
+				assert(0 == counting_bloom_add_hash(
+						filter->bloom[i], &h));
+			assert(0 == xid_table_insert(tmp_hashmap,
+					tmp_table[j]->prefix, table_hash(&h),
+					tmp_table[j]->nexthop));
 		}
 		filter->hashtable[i] = tmp_hashmap;
+		filter->length[i] = tmp_hashmap->count;
+		if (!(filter->blocked[i] = new_blocked_bloom(filter->bloom[i],
+						filter->arena))) {
+			printf("ERROR: Could not create bloom filter\n");
+			return NULL;
+		}
 	}
 	free(tmp_table);
 	return filter;
@@ -111,38 +357,363 @@ struct bloom_structure *bloom_create_fib(struct nextcreate *table,
 unsigned int lookup_bloom(unsigned char (*id)[HEXXID], unsigned int len,
 		void *bf)
 {
-	int i, min_len;
+	int i;
 	struct bloom_structure *filter = (struct bloom_structure *) bf;
-	unsigned int *nexthop = NULL;
-	// The returned values of counting_bloom_check() are 0 if found else 1
-	unsigned char matchvec[WDIST] = {0};
-	unsigned char tmp1[HEXXID + 1] = {0};
-	unsigned char tmp2[HEXXID] = {0};
-
-	memcpy(tmp1, id, HEXXID);
-	memcpy(tmp2, tmp1, HEXXID);
-	for (i = 0; i < WDIST; i++)
-		matchvec[i] = 1;
-	// Although the paper suggests to perform parallel membership queries
+	const unsigned int *nexthop = NULL;
+	unsigned char matchvec[WDIST];
+	unsigned char key[HEXXID];
+	struct prefix_hash p;
+	bloom_hash_t h[WDIST];
+	const blocked_bloom_t *b;
+
+	// Every length is hashed from the same pass over the XID, and the line
+	// each length probes is fetched before any of them is checked, which
+	// is as close as we get to the parallel membership queries of the paper
+	prefix_hash_init(&p, *id, filter->hash);
 	for (i = MAXLENGTH; i >= MINLENGTH; i--) {
-		tmp1[i / BYTE] = (tmp1[i / BYTE] >> (BYTE - i % BYTE)) <<
-							(BYTE - i % BYTE);
 		if (!filter->flag[i - MINLENGTH])
 			continue;
-		matchvec[i - MINLENGTH] =
-		counting_bloom_check(filter->bloom[i - MINLENGTH], tmp1,
-								HEXXID);
+		prefix_hash(&p, i, &h[i - MINLENGTH]);
+		b = filter->blocked[i - MINLENGTH];
+		__builtin_prefetch(b->line + (size_t) bloom_block(
+				&h[i - MINLENGTH], b->nblocks) *
+				BLOOM_BLOCKWORDS);
+	}
+	for (i = MAXLENGTH; i >= MINLENGTH; i--) {
+		matchvec[i - MINLENGTH] = filter->flag[i - MINLENGTH] &&
+			blocked_bloom_check(filter->blocked[i - MINLENGTH],
+					&h[i - MINLENGTH]);
 	}
-	// Parse the matchvec from longest to shortest to perform table search
+	// Parse the matchvec from longest to shortest to perform table search,
+	// masking the XID only for the lengths whose filter matched
 	for (i = MAXLENGTH; i >= MINLENGTH; i--) {
-		tmp2[i / BYTE] = (tmp2[i / BYTE] >> (BYTE - i % BYTE)) <<
-							(BYTE - i % BYTE);
-		if (!matchvec[i - MINLENGTH] || !filter->flag[i - MINLENGTH])
+		if (!matchvec[i - MINLENGTH])
 			continue;
-		nexthop = hashit_lookup(filter->hashtable[i - MINLENGTH],
-					tmp2);
+		prefix_key(&p, i, key);
+		nexthop = xid_table_lookup(filter->hashtable[i - MINLENGTH],
+				key, table_hash(&h[i - MINLENGTH]));
 		if (nexthop)
 			return *nexthop;
 	}
 	return 0;
 }
+
+/* Insert the prefix of length len of the XID of p into the table of len */
+static int insertmarker(struct bloom_structure *filter,
+		const struct prefix_hash *p, int len, unsigned int nexthop)
+{
+	unsigned char key[HEXXID];
+	bloom_hash_t h;
+
+	prefix_hash(p, len, &h);
+	prefix_key(p, len, key);
+	return xid_table_insert(filter->marker[len - MINLENGTH], key,
+			table_hash(&h), nexthop);
+}
+
+/*
+ * Build the tables of the binary search on prefix lengths from the prefixes
+ * in the hash tables, replacing the ones built before. Return 0 on success
+ * and -1 if a table could not be allocated.
+ *
+ * The search probes the middle level of the remaining ones and goes to the
+ * longer levels if the XID matches an entry there and to the shorter ones
+ * otherwise. A prefix leaves a marker at every level shorter than it where
+ * its search goes longer, so the search finds it, and every entry holds the
+ * next-hop of the longest prefix it matches, so the search does not need to
+ * go back when the longer levels do not match.
+ */
+int bloom_bsearch_build(struct bloom_structure *filter)
+{
+	struct nextcreate *entry, **stack;
+	const struct xid_slot *slot;
+	struct prefix_hash p;
+	unsigned long n = 0;
+	int i, j, top, lo, hi, mid, len;
+	size_t pos;
+
+	filter->bsearch = false;
+	filter->nlevels = 0;
+	for (i = 0; i < WDIST; i++) {
+		xid_table_destroy(filter->marker[i]);
+		filter->marker[i] = NULL;
+		if (!filter->flag[i])
+			continue;
+		filter->level[filter->nlevels++] = i + MINLENGTH;
+		n += filter->hashtable[i]->count;
+	}
+
+	entry = malloc((n + 1) * sizeof(struct nextcreate));
+	stack = malloc(WDIST * sizeof(struct nextcreate *));
+	assert(entry && stack);
+	n = 0;
+	for (i = 0; i < WDIST; i++) {
+		if (!filter->flag[i])
+			continue;
+		filter->marker[i] = xid_table_create_arena(2 * filter->length[i],
+				filter->arena);
+		if (!filter->marker[i])
+			goto fail;
+		for (pos = 0; (slot = xid_table_next(filter->hashtable[i],
+						&pos)) != NULL; n++) {
+			memcpy(entry[n].prefix, slot->key, HEXXID);
+			entry[n].len = i + MINLENGTH;
+			entry[n].nexthop = slot->nexthop;
+		}
+	}
+	qsort(entry, n, sizeof(struct nextcreate), sortbyprefix);
+
+	// The stack holds the prefixes of the current one, longest on top
+	top = 0;
+	for (j = 0; j < n; j++) {
+		len = entry[j].len;
+		while (top > 0 && xid_lcp((const xid *) stack[top - 1]->prefix,
+					(const xid *) entry[j].prefix) <
+				stack[top - 1]->len)
+			top--;
+		prefix_hash_init(&p, entry[j].prefix, filter->hash);
+		lo = 0;
+		hi = filter->nlevels - 1;
+		while (filter->level[mid = lo + (hi - lo) / 2] != len) {
+			if (filter->level[mid] > len) {
+				hi = mid - 1;
+				continue;
+			}
+			i = top;
+			while (i > 0 && stack[i - 1]->len > filter->level[mid])
+				i--;
+			if (insertmarker(filter, &p, filter->level[mid],
+						i > 0 ? stack[i - 1]->nexthop : 0))
+				goto fail;
+			lo = mid + 1;
+		}
+		if (insertmarker(filter, &p, len, entry[j].nexthop))
+			goto fail;
+		stack[top++] = &entry[j];
+	}
+	free(stack);
+	free(entry);
+	filter->bsearch = true;
+	return 0;
+
+fail:
+	free(stack);
+	free(entry);
+	return -1;
+}
+
+/*
+ * Look up id with a binary search on the prefix lengths, which probes the
+ * tables of O(log W) lengths
+ */
+unsigned int lookup_bloom_bsearch(unsigned char (*id)[HEXXID],
+		unsigned int len, void *bf)
+{
+	struct bloom_structure *filter = (struct bloom_structure *) bf;
+	const unsigned int *entry;
+	unsigned int nexthop = 0;
+	unsigned char key[HEXXID];
+	struct prefix_hash p;
+	bloom_hash_t h;
+	int lo = 0, hi = filter->nlevels - 1, mid, level;
+
+	if (!filter->bsearch)
+		return lookup_bloom(id, len, bf);
+	// A probe that misses reads a single control line of the table, which
+	// is what probing a blocked filter first would cost, so the search
+	// goes to the tables directly
+	prefix_hash_init(&p, *id, filter->hash);
+	while (lo <= hi) {
+		mid = lo + (hi - lo) / 2;
+		level = filter->level[mid];
+		prefix_hash(&p, level, &h);
+		prefix_key(&p, level, key);
+		entry = xid_table_lookup(filter->marker[level - MINLENGTH], key,
+				table_hash(&h));
+		if (entry) {
+			nexthop = *entry;
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return nexthop;
+}
+
+/* Give a length that has no prefix empty filters and an empty table */
+static int newlength(struct bloom_structure *filter, int i)
+{
+	filter->flag[i] = 1;
+	filter->length[i] = 0;
+	filter->bloom[i] = new_counting_bloom_arena(NTIMES, filter->error_rate,
+			filter->arena);
+	filter->hashtable[i] = xid_table_create_arena(1, filter->arena);
+	if (filter->bloom[i])
+		filter->blocked[i] = new_blocked_bloom(filter->bloom[i],
+				filter->arena);
+	if (!filter->bloom[i] || !filter->blocked[i] || !filter->hashtable[i]) {
+		freelength(filter, i);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Replace the filters of a length with ones of twice their capacity, filled
+ * from the prefixes of its table
+ */
+static int growlength(struct bloom_structure *filter, int i)
+{
+	counting_bloom_t *bloom;
+	blocked_bloom_t *blocked;
+	const struct xid_slot *slot;
+	struct prefix_hash p;
+	bloom_hash_t h;
+	size_t pos;
+
+	bloom = new_counting_bloom_arena(2 * filter->bloom[i]->capacity,
+			filter->error_rate, filter->arena);
+	if (!bloom)
+		return -1;
+	for (pos = 0; (slot = xid_table_next(filter->hashtable[i], &pos)) !=
+			NULL;) {
+		prefix_hash_init(&p, slot->key, filter->hash);
+		prefix_hash(&p, i + MINLENGTH, &h);
+		counting_bloom_add_hash(bloom, &h);
+	}
+	if (!(blocked = new_blocked_bloom(bloom, filter->arena))) {
+		free_counting_bloom(bloom);
+		return -1;
+	}
+	free_counting_bloom(filter->bloom[i]);
+	free_blocked_bloom(filter->blocked[i]);
+	filter->bloom[i] = bloom;
+	filter->blocked[i] = blocked;
+	return 0;
+}
+
+/*
+ * The routes changed, so the binary search falls back to lookup_bloom() until
+ * bloom_bsearch_build() is called again
+ */
+static void dropbsearch(struct bloom_structure *filter)
+{
+	int i;
+
+	if (!filter->bsearch)
+		return;
+	for (i = 0; i < WDIST; i++) {
+		xid_table_destroy(filter->marker[i]);
+		filter->marker[i] = NULL;
+	}
+	filter->nlevels = 0;
+	filter->bsearch = false;
+}
+
+/*
+ * Add the route prefix/len with the given next-hop, or replace the next-hop
+ * of the route if it is already present
+ *
+ * Return 1 if the routes changed, 0 if not and -1 if len is out of range or
+ * a filter or a table could not be allocated.
+ */
+int bloom_route_add(struct bloom_structure *filter,
+		const unsigned char *prefix, int len, unsigned int nexthop)
+{
+	const unsigned int *old;
+	unsigned char key[HEXXID];
+	struct prefix_hash p;
+	bloom_hash_t h;
+	int i = len - MINLENGTH;
+
+	if (len < MINLENGTH || len > MAXLENGTH)
+		return -1;
+	prefix_hash_init(&p, prefix, filter->hash);
+	prefix_hash(&p, len, &h);
+	prefix_key(&p, len, key);
+	if (!filter->flag[i] && newlength(filter, i))
+		return -1;
+
+	old = xid_table_lookup(filter->hashtable[i], key, table_hash(&h));
+	if (old && *old == nexthop)
+		return 0;
+	if (!old) {
+		// The filters keep the error rate they were designed for
+		// while the length holds at most their capacity
+		if (filter->length[i] + 1 > filter->bloom[i]->capacity &&
+				growlength(filter, i))
+			return -1;
+		counting_bloom_add_hash(filter->bloom[i], &h);
+		blocked_bloom_sync(filter->blocked[i], filter->bloom[i], &h);
+		filter->length[i]++;
+	}
+	if (xid_table_insert(filter->hashtable[i], key, table_hash(&h),
+				nexthop))
+		return -1;
+	dropbsearch(filter);
+	return 1;
+}
+
+/*
+ * Delete the route prefix/len
+ *
+ * Return 1 if the routes changed, 0 if the route is not present and -1 if
+ * len is out of range.
+ */
+int bloom_route_del(struct bloom_structure *filter,
+		const unsigned char *prefix, int len)
+{
+	unsigned char key[HEXXID];
+	struct prefix_hash p;
+	bloom_hash_t h;
+	int i = len - MINLENGTH;
+
+	if (len < MINLENGTH || len > MAXLENGTH)
+		return -1;
+	if (!filter->flag[i])
+		return 0;
+	prefix_hash_init(&p, prefix, filter->hash);
+	prefix_hash(&p, len, &h);
+	prefix_key(&p, len, key);
+	if (xid_table_delete(filter->hashtable[i], key, table_hash(&h)))
+		return 0;
+
+	if (0 == --filter->length[i]) {
+		freelength(filter, i);
+	} else {
+		counting_bloom_remove_hash(filter->bloom[i], &h);
+		blocked_bloom_sync(filter->blocked[i], filter->bloom[i], &h);
+	}
+	dropbsearch(filter);
+	return 1;
+}
+
+/*
+ * Probe the filter of every length for id as lookup_bloom() does and add to
+ * st the probes, the ones that matched and the ones that matched a prefix
+ * that is not in the table of their length
+ */
+void bloom_lookup_stat(unsigned char (*id)[HEXXID], void *bf,
+		struct bloom_stat *st)
+{
+	struct bloom_structure *filter = (struct bloom_structure *) bf;
+	unsigned char key[HEXXID];
+	struct prefix_hash p;
+	bloom_hash_t h;
+	int i;
+
+	prefix_hash_init(&p, *id, filter->hash);
+	for (i = 0; i < WDIST; i++) {
+		if (!filter->flag[i])
+			continue;
+		st->probes++;
+		prefix_hash(&p, i + MINLENGTH, &h);
+		if (!blocked_bloom_check(filter->blocked[i], &h))
+			continue;
+		st->positives++;
+		prefix_key(&p, i + MINLENGTH, key);
+		if (!xid_table_lookup(filter->hashtable[i], key,
+					table_hash(&h)))
+			st->false_positives++;
+	}
+}
@@ -14,7 +14,7 @@
 #include "bloom.h"
 #include "murmur.h"
 #include "generate_fibs.h"
-#include <hashit.h>
+#include "xid_table.h"
 #include <stdbool.h>
 
 #define WDIST 140
@@ -22,6 +22,18 @@
 #define MAXLENGTH 159
 #define NTIMES 2
 
+/* Hash functions of the prefixes, for bloom_create_fib_hash() */
+#define BLOOM_HASH_MURMUR3 0	/* a round of MurmurHash3_x64_128 per word */
+#define BLOOM_HASH_CRC32C 1	/* the SSE4.2 crc32 instruction */
+#define BLOOM_HASH_XXHASH 2	/* the tail step of XXH64 per word */
+#define BLOOM_HASH_MULSHIFT 3	/* a multiply-add per word, multiply-shift */
+#define BLOOM_NHASHES 4
+
+/* The hash of bloom_create_fib(), which can be set at compile time */
+#ifndef BLOOM_HASH
+#define BLOOM_HASH BLOOM_HASH_MURMUR3
+#endif
+
 struct bloom_structure {
 	// Although this could be computed using low and high, we are storing it
 	// for convenience.
@@ -29,14 +41,51 @@ struct bloom_structure {
 	unsigned int length[WDIST];
 	int low[WDIST];
 	int high[WDIST];
+	// The counting filters are kept for updates and lookups only probe
+	// the blocked filters derived from them
 	counting_bloom_t *bloom[WDIST];
-	hash_t hashtable[WDIST];
+	blocked_bloom_t *blocked[WDIST];
+	struct xid_table *hashtable[WDIST];
+	// Binary search on the populated lengths, built by
+	// bloom_bsearch_build(): level[] holds the lengths in ascending order
+	// and the table of a length holds its prefixes and the markers of the
+	// longer prefixes whose search goes through it, each with the next-hop
+	// of its best matching prefix
+	int nlevels;
+	unsigned char level[WDIST];
+	struct xid_table *marker[WDIST];
+	// Whether the tables of the binary search reflect the routes, which
+	// bloom_route_add() and bloom_route_del() do not keep up to date
+	bool bsearch;
+	double error_rate;
+	int hash;		// BLOOM_HASH_*
+	// The filters and the tables are taken from the arena while it has
+	// room, and from the heap after that
+	struct bloom_arena *arena;
+};
+
+struct bloom_stat {
+	unsigned long probes;
+	unsigned long positives;
+	unsigned long false_positives;
 };
 
 struct bloom_structure *bloom_create_fib(struct nextcreate *table,
 		unsigned long size, double error_rate);
 unsigned int lookup_bloom(unsigned char (*id)[HEXXID], unsigned int len,
 				void *bf);
+struct bloom_structure *bloom_create_fib_hash(struct nextcreate *table,
+		unsigned long size, double error_rate, int hash);
+int bloom_hash_supported(int hash);
+void bloom_lookup_stat(unsigned char (*id)[HEXXID], void *bf,
+		struct bloom_stat *st);
 int bloom_destroy_fib(struct bloom_structure *filter);
+int bloom_bsearch_build(struct bloom_structure *filter);
+unsigned int lookup_bloom_bsearch(unsigned char (*id)[HEXXID],
+		unsigned int len, void *bf);
+int bloom_route_add(struct bloom_structure *filter,
+		const unsigned char *prefix, int len, unsigned int nexthop);
+int bloom_route_del(struct bloom_structure *filter,
+		const unsigned char *prefix, int len);
 
 #endif
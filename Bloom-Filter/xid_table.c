@@ -0,0 +1,279 @@
+/*
+ * This is a free software and provides no guarantee of any kind.
+ * The distribution and changes to the software is as provided by the LICENSE.
+ * View the LICENSE file in github.com/sumefsp/LPM-Algorithms-Linux-XIA and
+ * any usage of code from this file must include this declaration.
+ *
+ * 2015, LPM Algorithms for Linux XIA
+ * Garnaik Sumeet, Michel Machado
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "xid_table.h"
+#include "arena.h"
+
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xfe
+/* Full slots hold the top 7 bits of the hash, so only they have bit 7 clear */
+#define CTRL_TAG(hash) ((hash) >> 25)
+
+/*
+ * Return a mask of the control bytes of the group at ctrl that are equal to c,
+ * bit i for byte i
+ */
+static inline unsigned int group_match(const uint8_t *ctrl, uint8_t c)
+{
+#ifdef __SSE2__
+	__m128i group = _mm_load_si128((const __m128i *) ctrl);
+
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(c)));
+#else
+	unsigned int i, m = 0;
+
+	for (i = 0; i < XID_TABLE_GROUP; i++)
+		m |= (ctrl[i] == c) << i;
+	return m;
+#endif
+}
+
+/* Return a mask of the slots of the group at ctrl that are empty or deleted */
+static inline unsigned int group_free(const uint8_t *ctrl)
+{
+#ifdef __SSE2__
+	return _mm_movemask_epi8(_mm_load_si128((const __m128i *) ctrl));
+#else
+	unsigned int i, m = 0;
+
+	for (i = 0; i < XID_TABLE_GROUP; i++)
+		m |= (ctrl[i] >> 7) << i;
+	return m;
+#endif
+}
+
+/* Return the slot of key, or -1 if it is not in the table */
+static long findslot(const struct xid_table *t, const unsigned char *key,
+		uint32_t hash)
+{
+	unsigned int g = hash & t->mask, i = 0, m;
+	const struct xid_slot *s;
+	const uint8_t *ctrl;
+
+	for (;;) {
+		ctrl = t->ctrl + (size_t) g * XID_TABLE_GROUP;
+		for (m = group_match(ctrl, CTRL_TAG(hash)); m; m &= m - 1) {
+			s = &t->slot[(size_t) g * XID_TABLE_GROUP +
+				__builtin_ctz(m)];
+			if (s->hash == hash &&
+					!memcmp(s->key, key, XID_TABLE_KEY))
+				return s - t->slot;
+		}
+		// A key is never placed past a group with an empty slot
+		if (group_match(ctrl, CTRL_EMPTY))
+			return -1;
+		// Triangular steps visit every group of a power of two
+		g = (g + ++i) & t->mask;
+	}
+}
+
+/*
+ * Put a key that is not in the table in the first free slot of its probe
+ * sequence and return that slot
+ */
+static struct xid_slot *placeslot(struct xid_table *t, uint32_t hash)
+{
+	unsigned int g = hash & t->mask, i = 0, m;
+	size_t adr;
+
+	while (!(m = group_free(t->ctrl + (size_t) g * XID_TABLE_GROUP)))
+		g = (g + ++i) & t->mask;
+	adr = (size_t) g * XID_TABLE_GROUP + __builtin_ctz(m);
+	if (CTRL_EMPTY == t->ctrl[adr])
+		t->used++;
+	t->ctrl[adr] = CTRL_TAG(hash);
+	t->count++;
+	return &t->slot[adr];
+}
+
+/* Free an array of t unless it is in the arena of t */
+static void freearray(const struct xid_table *t, void *p)
+{
+	if (!bloom_arena_owns(t->arena, p))
+		free(p);
+}
+
+/* Allocate ngroups empty groups, a power of two */
+static int allocgroups(struct xid_table *t, unsigned int ngroups)
+{
+	size_t nslots = (size_t) ngroups * XID_TABLE_GROUP;
+
+	t->ctrl = bloom_arena_alloc(t->arena, nslots);
+	if (!t->ctrl && posix_memalign((void **) &t->ctrl, 64, nslots))
+		return -1;
+	t->slot = bloom_arena_alloc(t->arena, nslots * sizeof(struct xid_slot));
+	if (!t->slot && posix_memalign((void **) &t->slot, 64,
+				nslots * sizeof(struct xid_slot))) {
+		freearray(t, t->ctrl);
+		return -1;
+	}
+	memset(t->ctrl, CTRL_EMPTY, nslots);
+	t->mask = ngroups - 1;
+	t->count = 0;
+	t->used = 0;
+	return 0;
+}
+
+/* Return the number of groups that keep capacity keys under 7/8 full */
+static unsigned int groupsfor(unsigned int capacity)
+{
+	unsigned long need = ((unsigned long) capacity * 8 / 7 +
+			XID_TABLE_GROUP) / XID_TABLE_GROUP;
+	unsigned int ngroups = 1;
+
+	while (ngroups < need)
+		ngroups *= 2;
+	return ngroups;
+}
+
+/* Move the full slots of t to a table of ngroups groups */
+static int rehash(struct xid_table *t, unsigned int ngroups)
+{
+	struct xid_table old = *t;
+	size_t i;
+
+	if (allocgroups(t, ngroups)) {
+		*t = old;
+		return -1;
+	}
+	for (i = 0; i < (size_t) (old.mask + 1) * XID_TABLE_GROUP; i++) {
+		if (!(old.ctrl[i] & CTRL_EMPTY))
+			*placeslot(t, old.slot[i].hash) = old.slot[i];
+	}
+	freearray(&old, old.ctrl);
+	freearray(&old, old.slot);
+	return 0;
+}
+
+/*
+ * Create a table sized for capacity keys, which grows past that
+ */
+struct xid_table *xid_table_create(unsigned int capacity)
+{
+	return xid_table_create_arena(capacity, NULL);
+}
+
+/*
+ * Same as xid_table_create(), with the arrays taken from arena while it has
+ * room, also when the table grows
+ */
+struct xid_table *xid_table_create_arena(unsigned int capacity,
+		struct bloom_arena *arena)
+{
+	struct xid_table *t;
+
+	if ((t = malloc(sizeof(struct xid_table))) == NULL)
+		return NULL;
+	t->arena = arena;
+	if (allocgroups(t, groupsfor(capacity))) {
+		free(t);
+		return NULL;
+	}
+	return t;
+}
+
+/* Return the bytes that a table for capacity keys takes from an arena */
+size_t xid_table_footprint(unsigned int capacity)
+{
+	size_t nslots = (size_t) groupsfor(capacity) * XID_TABLE_GROUP;
+
+	return nslots * (1 + sizeof(struct xid_slot)) + 2 * ARENA_ALIGN;
+}
+
+void xid_table_destroy(struct xid_table *t)
+{
+	if (t != NULL) {
+		freearray(t, t->ctrl);
+		freearray(t, t->slot);
+		free(t);
+	}
+}
+
+/*
+ * Insert key with the given next-hop, or replace its next-hop if it is in the
+ * table already. Return 0 on success and -1 if the table could not grow.
+ */
+int xid_table_insert(struct xid_table *t, const unsigned char *key,
+		uint32_t hash, unsigned int nexthop)
+{
+	struct xid_slot *s;
+	long adr;
+
+	if ((adr = findslot(t, key, hash)) >= 0) {
+		t->slot[adr].nexthop = nexthop;
+		return 0;
+	}
+	// Keep an empty slot in every probe sequence, dropping the deleted
+	// slots and doubling the table only if the keys need it
+	if (t->used + 1 > (t->mask + 1) * XID_TABLE_GROUP / 8 * 7 &&
+			rehash(t, groupsfor(2 * (t->count + 1))))
+		return -1;
+	s = placeslot(t, hash);
+	memcpy(s->key, key, XID_TABLE_KEY);
+	s->nexthop = nexthop;
+	s->hash = hash;
+	return 0;
+}
+
+/*
+ * Remove key from the table. Return 0 on success and -1 if it is not in the
+ * table.
+ */
+int xid_table_delete(struct xid_table *t, const unsigned char *key,
+		uint32_t hash)
+{
+	long adr = findslot(t, key, hash);
+	const uint8_t *ctrl;
+
+	if (adr < 0)
+		return -1;
+	// A lookup stops at a group with an empty slot, so the slot can be
+	// emptied if its group has one
+	ctrl = t->ctrl + adr / XID_TABLE_GROUP * XID_TABLE_GROUP;
+	if (group_match(ctrl, CTRL_EMPTY)) {
+		t->ctrl[adr] = CTRL_EMPTY;
+		t->used--;
+	} else {
+		t->ctrl[adr] = CTRL_DELETED;
+	}
+	t->count--;
+	return 0;
+}
+
+/*
+ * Return a pointer to the next-hop of key, or NULL if it is not in the table
+ */
+const unsigned int *xid_table_lookup(const struct xid_table *t,
+		const unsigned char *key, uint32_t hash)
+{
+	long adr = findslot(t, key, hash);
+
+	return adr < 0 ? NULL : &t->slot[adr].nexthop;
+}
+
+/*
+ * Return the first full slot at or after slot *pos and move *pos past it, or
+ * NULL if there is none. Starting from *pos = 0 visits every key once.
+ */
+const struct xid_slot *xid_table_next(const struct xid_table *t, size_t *pos)
+{
+	size_t nslots = (size_t) (t->mask + 1) * XID_TABLE_GROUP;
+
+	for (; *pos < nslots; (*pos)++) {
+		if (!(t->ctrl[*pos] & CTRL_EMPTY))
+			return &t->slot[(*pos)++];
+	}
+	return NULL;
+}
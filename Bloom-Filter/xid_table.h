@@ -0,0 +1,62 @@
+/*
+ * This is a free software and provides no guarantee of any kind.
+ * The distribution and changes to the software is as provided by the LICENSE.
+ * View the LICENSE file in github.com/sumefsp/LPM-Algorithms-Linux-XIA and
+ * any usage of code from this file must include this declaration.
+ *
+ * 2015, LPM Algorithms for Linux XIA
+ * Garnaik Sumeet, Michel Machado
+ *
+ * An open-addressing hash table of XID prefixes of one length and their
+ * next-hops.
+ *
+ * The slots are split in groups of XID_TABLE_GROUP, and every slot has a
+ * control byte that tells whether it is empty, deleted or full, and for a full
+ * slot holds 7 bits of the hash of its key. A lookup compares the control
+ * bytes of a whole group with the tag of its key at once and only reads the
+ * slots that match, which hold the key and the next-hop inline. The caller
+ * hashes the keys, so the table never reads a key to hash it.
+ */
+#ifndef _XID_TABLE_H_
+#define _XID_TABLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct bloom_arena;
+
+#define XID_TABLE_KEY 20	/* bytes of a key, HEXXID */
+#define XID_TABLE_GROUP 16	/* control bytes compared at once */
+
+struct xid_slot
+{
+	unsigned char key[XID_TABLE_KEY];
+	unsigned int nexthop;
+	uint32_t hash;		//Kept to move the slot when the table grows
+	uint32_t _pad;
+} __attribute__((aligned(32)));
+
+struct xid_table
+{
+	uint8_t *ctrl;		//Control bytes, one group per XID_TABLE_GROUP slots
+	struct xid_slot *slot;
+	unsigned int mask;	//Number of groups - 1
+	unsigned int count;	//Full slots
+	unsigned int used;	//Full and deleted slots
+	struct bloom_arena *arena;	//Tried first for the arrays, or NULL
+};
+
+struct xid_table *xid_table_create(unsigned int capacity);
+struct xid_table *xid_table_create_arena(unsigned int capacity,
+		struct bloom_arena *arena);
+size_t xid_table_footprint(unsigned int capacity);
+void xid_table_destroy(struct xid_table *t);
+int xid_table_insert(struct xid_table *t, const unsigned char *key,
+		uint32_t hash, unsigned int nexthop);
+int xid_table_delete(struct xid_table *t, const unsigned char *key,
+		uint32_t hash);
+const unsigned int *xid_table_lookup(const struct xid_table *t,
+		const unsigned char *key, uint32_t hash);
+const struct xid_slot *xid_table_next(const struct xid_table *t, size_t *pos);
+
+#endif
@@ -23,6 +23,8 @@
    Modified for LPM Algorithms Testing in Linux-XIA
 */
 #include <stddef.h>
+#include <assert.h>
+#include <pthread.h>
 #include "xidsort.h"
 #include "lc_trie.h"
 
@@ -39,6 +41,11 @@ int compareentries(const void *id1, const void *id2)
 
 	tmpresult = comparexid(&tmp_id1, &tmp_id2);
 
+	// Entries with the same bits are ordered by length so that the shorter
+	// one is always found to be a prefix of the longer one
+	if (0 == tmpresult)
+		tmpresult = (*tmp_entry1)->len - (*tmp_entry2)->len;
+
 	if (tmpresult < 0)
 		return -1;
 	else if (tmpresult > 0)
@@ -46,426 +53,428 @@ int compareentries(const void *id1, const void *id2)
 	else
 		return 0;
 }
-/*
-static int count_pat_nodes(node_patric *n)
-{
-	if (NULL == n->left) {
-		free(n);
-		return 1;
-	} else {
-		int i = count_pat_nodes(n->left) + count_pat_nodes(n->right) + 1;
-		free(n);
-		return i;
-	}
-}
-*/
 /*
  * Compute the number of bits to be skipped for a range of XID addresses.
  *
- * base: base vector
- * prefix: prefix common to the XIDs starting at position first and having
- * total n such XIDs
- */
-static int skipcompute(base_t base[], int prefix, int first, int n)
-{
-	int i, match;
-	xid low, high, *plow, *phigh;
-
-	// Compute the skip value for that node
-	low = removexid(prefix, base[first]->str);
-	high = removexid(prefix, base[first + n - 1]->str);
-	i = prefix;
-	plow = malloc(sizeof(xid));
-	phigh = malloc(sizeof(xid));
-	*plow = extract(i, 1, low);
-	*phigh = extract(i, 1, high);
-	match = comparexid(&plow, &phigh);
-	while (0 == match) {
-		i++;
-		*plow = extract(i, 1, low);
-		*phigh = extract(i, 1, high);
-		match = comparexid(&plow, &phigh);
-	}
-	free(plow);
-	free(phigh);
-	return i;
-}
-
-/*
- * Computes the total number of base XIDs for a given prefix
- * 
- * base: base vector
- * prefix: number of bits that are common to the callee node
- * first: starting address of the base for callee node
- * n: number of addresses of the base for the callee node
+ * Since the base vector is sorted, the bits common to all the XIDs starting at
+ * position first and having total n such XIDs are the longest common prefix
+ * of the first and the last of them.
  */
-static int subtriecompute(base_t base[], int prefix, int first, int n)
+static int skipcompute(base_t base[], int first, int n)
 {
-	xid tmp;
-	int nleft = 0;
-	unsigned char left = (unsigned char) 0;
-
-	// Find the number of prefixes in base that belong to left subtrie
-	tmp = extract(prefix, 1, base[first]->str);
-	while (left == tmp.w[HEXXID - 1]) {
-		nleft++;
-		tmp = extract(prefix, 1, base[first + nleft]->str);
-	}
-	return nleft;
+	return xid_lcp(&base[first]->str, &base[first + n - 1]->str);
 }
 
 /*
- * This routine builds the Patricia trie recursively for all nodes in the range
- * of address "first" to "first + n -1" in base vector: base passed as arg
+ * Compute the branching factor of a node for the XIDs in the range of address
+ * "first" to "first + n - 1" in the base vector
  *
- * base: base vector
+ * lcp: lcp[i] is the longest common prefix of base[i] and base[i + 1]
  * prefix: number of bits that are common to all the XIDs in the range
- * "first" to "first + n - 1"
  * first: first index of base vector
- * n: number of prefixes in base vector starting at index first 
+ * n: number of XIDs in the range, at least 2
+ * opts: build options
+ *
+ * The branch is the largest b such that at least fillfactor * 2^b of the 2^b
+ * values of the b bits after prefix are taken by some XID. A fill factor of 1
+ * only compresses complete levels; a smaller one accepts empty children in
+ * exchange for a shallower trie.
+ *
+ * Two neighbouring XIDs differ in the b bits after prefix exactly when their
+ * lcp is below prefix + b, so a single pass over lcp counts the values taken
+ * for every b at once.
  */
-static node_patric *buildpatricia(base_t base[], int prefix, int first, int n)
+static int branchcompute(const uint8_t lcp[], int prefix, int first, int n,
+		const struct lctrie_build_opts *opts)
 {
-	int i,newprefix, nleft;
-	node_patric *node;
-
-	// Reached the leaf node
-	if (1 == n) {
-		node = malloc(sizeof(node_patric));
-		node->left = NULL;
-		node->right = NULL;
-		node->skip = base[first]->len - prefix;
-		node->base = first;
-		return node;
-	}
+	int diff[MAXBRANCH + 1] = {0};
+	int maxbranch = opts->maxbranch;
+	int b, i, count;
 
-	//Find the number of bits to be skipped for the new node being constructed
-	//and range of XIDs for each of its child
-	newprefix = skipcompute(base, prefix, first, n);
-	node = malloc(sizeof(node_patric));
-	node->skip = newprefix - prefix;
-	node->base = NOBASE;
-	nleft = subtriecompute(base, newprefix, first, n);
-	node->left = buildpatricia(base, newprefix + 1, first, nleft);
-	node->right = buildpatricia(base, newprefix + 1, first + nleft, n - nleft);
-	return node;
-}
+	if (maxbranch > ADRSIZE - prefix)
+		maxbranch = ADRSIZE - prefix;
 
-/*
- * This routine gives information regarding level compression i.e can "node" and
- * its children that were to be removed in level compression be removed.
- *
- * node: node of lctrie
- * level: level of node wrt node that demands compression
- */
-static int compressperm(node_lc *node, int level)
-{
-	if (1 == level) {
-		if (node->skip)
-			return 1;
-		else
-			return 0;
+	// diff[d] is the number of neighbours that first differ at prefix + d
+	for (i = first; i < first + n - 1; i++) {
+		if (lcp[i] - prefix < maxbranch)
+			diff[lcp[i] - prefix]++;
 	}
-	if (node->skip)
-		return 1;
-	return (compressperm(node->subtrie[0], level - 1) +
-			compressperm(node->subtrie[1], level - 1));
+
+	// Two XIDs that differ after prefix always give a node with two children
+	count = 1 + diff[0];
+	for (b = 2; b <= maxbranch; b++) {
+		if (n < opts->fillfactor * (1 << b))
+			break;
+		count += diff[b - 1];
+		if (count < opts->fillfactor * (1 << b))
+			break;
+	}
+	return b - 1;
 }
 
 /*
- * This routine updates the branching factor of the node depending on the option
- * of being able to skip or not.
+ * Choose the base vector entry for a child that no XID falls in.
+ *
+ * base: base vector
+ * first: first index of base vector for the parent node
+ * n: number of XIDs of the parent node
+ * p: index in base vector where XIDs with the pattern of the child would be
+ * prefix: the bit position where the branch bits of the parent start
+ * branch: branching factor of the parent
+ * bitpat: the pattern of the child
  *
- * node: node of lctrie
+ * A lookup ending in this child can only be matched by prefixes that are
+ * shorter than prefix + branch. Of the neighbouring XIDs base[p - 1] and
+ * base[p], the one sharing more bits with bitpat has every such prefix in its
+ * prefix chain.
  */
-static int updatebranch(node_lc *node)
+static int emptychild(base_t base[], int first, int n, int p, int prefix,
+		int branch, uint32_t bitpat)
 {
-	if (0 == node->branch)
-		return 0;
-	updatebranch(node->subtrie[0]);
-	updatebranch(node->subtrie[1]);
-	if (1 == node->branch)
-		return 0;
-	if (compressperm(node->subtrie[0], node->branch - 1) +
-			compressperm(node->subtrie[1], node->branch - 1))
-		node->branch = 1;
-	return 0;
+	uint32_t left, right;
+
+	if (first == p)
+		return p;
+	if (first + n == p)
+		return p - 1;
+	left = xid_bits_u32(&base[p - 1]->str, prefix, branch) ^ bitpat;
+	right = xid_bits_u32(&base[p]->str, prefix, branch) ^ bitpat;
+	return left < right ? p - 1 : p;
 }
 
 /*
- * Compute the branching factor of each node i.e number of complete levels
- * below "node"
- *
- * node: a node in a Patricia Trie (in level compression supporting data
- * structure)
+ * Reserve n consecutive nodes at the end of the trie array, growing it if
+ * needed, and return the address of the first of them.
  */
-static int branchcompute(node_lc *node)
+static int allocnodes(node_t **trie, int *nnodes, int *maxnodes, int n)
 {
-	int b1, b2;
+	int adr = *nnodes;
 
-	//If leaf node
-	if (NULL == node->subtrie) {
-		node->branch = 0;
-		return 0;
+	while (*nnodes + n > *maxnodes) {
+		*maxnodes *= 2;
+		*trie = realloc(*trie, *maxnodes * sizeof(node_t));
+		assert(*trie);
 	}
-	b1 = branchcompute(node->subtrie[0]);
-	b2 = branchcompute(node->subtrie[1]);
-	//Select the lesser of the two values returned by the two child nodes since
-	//that would represent the total number of complete levels below the current
-	//node
-	if ((b1 == b2) || (b1 > b2))
-		node->branch = 1 + b2;
-	else
-		node->branch = 1 + b1;
-	return node->branch;
+	*nnodes += n;
+	return adr;
 }
 
-/*
- * Count the total number of nodes in each level (root has level=0)
- *
- * node: address of a node in the LC-Trie
- * level: array consisting of number of nodes in each level
- * clevel: the current level of "node"
- */
-static int countlevels(node_lc *node, int *level, int clevel)
-{
-	unsigned long tmp, i;
-	level[clevel]++;
+#define PARALLELMIN (1 << 14)	/* fewest XIDs to build with several threads */
+#define PARALLELSPLIT 8		/* subtries to be built per thread */
 
-	if (NULL == node->subtrie)
-		return 0;
-	tmp = 1 << (node->branch);
-	for (i = 0; i < tmp; i++)
-		countlevels(node->subtrie[i], level, clevel + 1);
-}
+/* A subtrie that is still to be built, see buildtrie() */
+struct buildframe
+{
+	int prefix;	//Number of bits common to the XIDs of the subtrie
+	int first;	//First index of base vector
+	int n;		//Number of XIDs in base vector starting at index first
+	int pos;	//Address of the root of the subtrie in the trie array
+};
 
 /*
- * Compute the address the node shall occupy in the array of LC-Trie and the
- * address the left most child of this node shall occupy in the array
- *
- * node: address of the node under consideration
- * level: an array representing the total number of nodes in each level
- * fill: an array that consists of the total number of nodes that are to the
- * left of "node" in the same level, where level in the array "level" is
- * represented by the index.
+ * Push a subtrie to be built on the stack of buildtrie(), growing it if needed
  */
-static int addrarray(node_lc *node, int *level, int *fill, int clevel)
+static void pushframe(struct buildframe **stack, int *top, int *size,
+		int prefix, int first, int n, int pos)
 {
-	int tmp, i;
-	int sum = 0;
-	node_t k, l;
-
-	for (i = 0; i < clevel; i++)
-		sum += level[i];
-	tmp = sum + fill[clevel];
-	fill[clevel]++;
-	node->addr = tmp;
-	//When a leaf node is reached child shall contain the address of string
-	//in base vector
-	if (0 == node->branch) {
-		node->child = node->base;
-		return 0;
+	if (*top == *size) {
+		*size *= 2;
+		*stack = realloc(*stack, *size * sizeof(struct buildframe));
+		assert(*stack);
 	}
-	l = 1 << (node->branch);
-	for (k = 0; k < l; k++)
-		addrarray(node->subtrie[k], level, fill, clevel+1);
-	//When internal node child shall contain the address (array) of the left
-	//most node it points to
-	node->child = (node->subtrie[0])->addr;
+	(*stack)[*top].prefix = prefix;
+	(*stack)[*top].first = first;
+	(*stack)[*top].n = n;
+	(*stack)[*top].pos = pos;
+	(*top)++;
 }
 
 /*
- * Fill the array with the nodes of the LC-Trie and free the memory occupied
- * by the linked list representation of LC-Trie.
+ * Build the node of the subtrie f and push the subtries of its children that
+ * hold XIDs on the stack of frames, in order of their branch bits
+ *
+ * base: base vector
+ * lcp: lcp[i] is the longest common prefix of base[i] and base[i + 1]
+ * f: the subtrie whose root is to be built
+ * rootbranch: branching factor of the node, 0 to compute it
+ * trie, nnodes, maxnodes: the trie array, its used nodes and its capacity
+ * opts: build options
+ * stack, top, size: the stack of frames, its used frames and its capacity
  *
- * table: the final array that contains the LC-Trie
- * node: the address of the node that is currently being filled in the trie 
+ * Building a node takes one pass over the lcp values of its range to choose
+ * the branch and one more to split the range among its children, so no bit
+ * is extracted from an XID more than once per node.
  */
-static int fillarray(node_t *table, node_lc *node)
+static void buildnode(base_t base[], const uint8_t lcp[], struct buildframe f,
+		int rootbranch, node_t **trie, int *nnodes, int *maxnodes,
+		const struct lctrie_build_opts *opts,
+		struct buildframe **stack, int *top, int *size)
 {
-	node_t k, l;
-	node_t tmp = 0;
+	int newprefix, branch, adr, p, i;
+	uint32_t bitpat, nextpat;
 
-	tmp = ((node_t) node->branch) << 40 | ((node_t) node->skip) << 32 |
-							(node_t) node->child;
-	table[node->addr] = tmp;
-	if (0 == node->branch)
-		return 0;
-	l = 1 << (node->branch);
-	for (k = 0; k < l; k++)
-		fillarray(table, node->subtrie[k]);
+	// Reached a leaf, it only holds the address in base vector
+	if (1 == f.n) {
+		(*trie)[f.pos] = (node_t) f.first;
+		return;
+	}
+
+	newprefix = skipcompute(base, f.first, f.n);
+	if (rootbranch > 0)
+		branch = rootbranch < ADRSIZE - newprefix ?
+				rootbranch : ADRSIZE - newprefix;
+	else
+		branch = branchcompute(lcp, newprefix, f.first, f.n, opts);
+
+	adr = allocnodes(trie, nnodes, maxnodes, 1 << branch);
+	(*trie)[f.pos] = ((node_t) branch) << 40 |
+			((node_t) (newprefix - f.prefix)) << 32 | (node_t) adr;
+
+	// A run of XIDs with the same branch bits ends where the lcp of two
+	// neighbours is shorter than newprefix + branch. Every run is a subtrie
+	// to be built, and every value of the branch bits between two runs is
+	// a child without XIDs.
+	nextpat = 0;
+	for (p = f.first; p < f.first + f.n; p = i) {
+		bitpat = xid_bits_u32(&base[p]->str, newprefix, branch);
+		for (; nextpat < bitpat; nextpat++)
+			(*trie)[adr + nextpat] = (node_t) emptychild(base,
+					f.first, f.n, p, newprefix, branch,
+					nextpat);
+		for (i = p + 1; i < f.first + f.n &&
+				lcp[i - 1] >= newprefix + branch; i++)
+			;
+		pushframe(stack, top, size, newprefix + branch, p, i - p,
+				adr + bitpat);
+		nextpat = bitpat + 1;
+	}
+	for (; nextpat < (1U << branch); nextpat++)
+		(*trie)[adr + nextpat] = (node_t) emptychild(base, f.first, f.n,
+				f.first + f.n, newprefix, branch, nextpat);
 }
 
 /*
- * Convert the linked list representation to array representation to enable
- * fast lookup using the algorithm that levereages the idea of using words
- * to minimize memory accesses.
+ * This routine builds the LC-Trie for the subtrie f of the sorted base vector
+ *
+ * base: base vector
+ * lcp: lcp[i] is the longest common prefix of base[i] and base[i + 1]
+ * f: the subtrie, whose root is stored at address f.pos of the trie array
+ * rootbranch: branching factor of the root of the subtrie, 0 to compute it
+ * trie, nnodes, maxnodes: the trie array, its used nodes and its capacity
+ * opts: build options
  *
- * root: address of the root node of the LC-Trie
- * table: the address of the array where the LC-Trie is to be stored
- * n: total number of nodes in the LC-Trie i.e total number of nodes present in
- * table
+ * The subtries still to be built are kept on an explicit stack instead of
+ * recursing, so every level of the trie costs O(f.n). The children of a node
+ * take 2^branch consecutive addresses allocated when the node is built, and
+ * children are popped in order, so the trie array is laid out depth first.
  */
-static int lltoarray(node_lc *root, node_t *table, int *n)
+static void buildtrie(base_t base[], const uint8_t lcp[], struct buildframe f,
+		int rootbranch, node_t **trie, int *nnodes, int *maxnodes,
+		const struct lctrie_build_opts *opts)
 {
-	int level[ADRSIZE] = {0};
-	int i, sum = 0;
-
-	//Count the total number of nodes in each level where root has ``level"=0
-	//and increases linearly as we traverse in a depth first manner
-	countlevels(root, level, 0);
-	for (i = 0; i < ADRSIZE; i++) {
-		if (0 == level[i])
-			break;
-		sum += level[i];
+	struct buildframe *stack, tmp;
+	int top = 0, size = 64;
+	int lo, hi;
+
+	stack = malloc(size * sizeof(struct buildframe));
+	pushframe(&stack, &top, &size, f.prefix, f.first, f.n, f.pos);
+
+	while (top > 0) {
+		f = stack[--top];
+		lo = top;
+		buildnode(base, lcp, f, rootbranch, trie, nnodes, maxnodes,
+				opts, &stack, &top, &size);
+		rootbranch = 0;
+
+		// Pop the children in order of their branch bits
+		for (hi = top - 1; lo < hi; lo++, hi--) {
+			tmp = stack[lo];
+			stack[lo] = stack[hi];
+			stack[hi] = tmp;
+		}
 	}
 
-	//Represents the current number of nodes that have been filled in that level
-	//in a breadth first fashion with the index representing the level.
-	int fill[i];
-	memset(fill, 0, sizeof(int) * i);
-	*n = sum;
-
-	//Compute the address the node is to occupy in the array and the address of
-	//the left most node it points to
-	addrarray(root, level, fill, 0);
-
-	//Fill the array with the nodes of the LC-Trie and free the memory occupied
-	//by the linked list representation of LC-Trie
-	fillarray(table, root);
-	return 0;
+	free(stack);
 }
 
+/* State shared by the threads of buildtrie_parallel() */
+struct buildshared
+{
+	base_t *base;
+	const uint8_t *lcp;
+	const struct lctrie_build_opts *opts;
+	struct buildframe *frames;	//The subtries to be built
+	int nframes;
+	int next;	//The next subtrie to be taken by a thread
+	int *owner;	//The thread that built each subtrie
+	int *offset;	//The address of its root in the array of that thread
+	int *count;	//The number of its nodes
+};
+
+/* A thread of buildtrie_parallel() and the trie array it builds into */
+struct buildworker
+{
+	pthread_t thread;
+	int id;
+	struct buildshared *shared;
+	node_t *trie;
+	int nnodes;
+	int maxnodes;
+};
+
 /*
- * Compute the addresses of all the nodes that are "level"s below the node
- *
- * node: a node that is strictly internal since the recursive call begins from
- * internal node and terminating condition mandates terminating before reaching
- * a leaf node
- * level: the number of vertical levels below "node" whose addresses are
- * required to be passed to the caller.
+ * Take subtries from the shared list until none is left and build each of
+ * them into the private trie array of the thread, one after the other
  */
-static node_lc **compressedaddr(node_lc *node, int level)
+static void *buildworker(void *arg)
 {
-	unsigned long tmp_branch, i;
-	node_lc **tmp = NULL;
-
-	//If the node is parent of the nodes that will be the new children after
-	//level compression of Patricia trie
-	if (1 == level) {
-		tmp = node->subtrie;
-		free(node);
-		return tmp;
+	struct buildworker *w = arg;
+	struct buildshared *sh = w->shared;
+	struct buildframe f;
+	int i;
+
+	while ((i = __sync_fetch_and_add(&sh->next, 1)) < sh->nframes) {
+		f = sh->frames[i];
+		f.pos = allocnodes(&w->trie, &w->nnodes, &w->maxnodes, 1);
+		buildtrie(sh->base, sh->lcp, f, 0, &w->trie, &w->nnodes,
+				&w->maxnodes, sh->opts);
+		sh->owner[i] = w->id;
+		sh->offset[i] = f.pos;
+		sh->count[i] = w->nnodes - f.pos;
 	}
-	//An intermediate node that asks both its children to give the addresses of
-	//nodes present "level"s below this node
-	node_lc **left = NULL, **right = NULL;
-	left = compressedaddr(node->subtrie[0], level - 1);
-	right = compressedaddr(node->subtrie[1], level - 1);
-	free(node->subtrie);
-	tmp = malloc((1 << level) * sizeof(node_lc *));
-	tmp_branch = 1 << (level - 1);
-	for (i = 0; i < tmp_branch; i++) {
-		tmp[i] = left[i];
-		tmp[i + tmp_branch] = right[i];
-	}
-	free(node);
-	return tmp;
+	return NULL;
 }
 
 /*
- * Compresses the Patricia trie into LC-Trie with the internal nodes removed
- * from memory.
- *
- * node: Node of the Patricia trie in the new data structure that supports
- * level compression.
+ * Move a node built at another address by shift. Leaves hold an address in
+ * base vector, which does not move.
  */
-static int compresspattolc(node_lc *node)
+static inline node_t movenode(node_t node, int shift)
 {
-	unsigned long i, tmp;
-
-	//If leaf node
-	if (0 == node->branch) {
-		return 0;
-	} else if (1 == node->branch) {
-		// This is when node has two children or there is information
-		// loss due to nodes having skip values
-		compresspattolc(node->subtrie[0]);
-		compresspattolc(node->subtrie[1]);
-		return 0;
-	}
-	//If branching factor is more than 1 i.e there is need for compression
-	node_lc **left = NULL, **right = NULL;
-
-	//Find the addresses of the nodes that will be the new children after the
-	//compression is achieved in this node
-	left = compressedaddr(node->subtrie[0], node->branch - 1);
-	right = compressedaddr(node->subtrie[1], node->branch - 1);
-	free(node->subtrie);
-	node->subtrie = malloc((1 << node->branch) * sizeof(node_lc *));
-	tmp = 1 << (node->branch - 1);
-	for (i = 0; i < tmp; i++) {
-		node->subtrie[i] = left[i];
-		node->subtrie[i + tmp] = right[i];
-	}
-	//Recursively call this routine for all the new children after the
-	//compression is achieved
-	for (i = 0; i < (tmp << 1); i++)
-		compresspattolc(node->subtrie[i]);
+	if (0 == GETBRANCH(node))
+		return node;
+	return node + (node_t) (int64_t) shift;
 }
 
 /*
- * Converts the Patricia trie from the original minimalist data structure
- * to a new data structure that supports the level compression to be performed
- * to generate the LC-Trie.
- *
- * node: the root address of the Patricia trie
+ * This routine builds the LC-Trie for the nbases XIDs of the sorted base
+ * vector with nthreads threads and stores its root at address 0 of the trie
+ * array
  *
- * Returns the root address of the new level compression supporting data
- * structure.
+ * The top of the trie is built breadth first until there are PARALLELSPLIT
+ * subtries per thread. The threads then build those subtries, which are
+ * independent, into private arrays. The subtries are finally copied after
+ * the top of the trie in the order they were split, with the root of each
+ * one stored in its place in its parent and the child addresses of its
+ * internal nodes moved by the difference between the two arrays.
  */
-static node_lc *pattonewdata(node_patric *node)
+static void buildtrie_parallel(base_t base[], const uint8_t lcp[], int nbases,
+		node_t **trie, int *nnodes, int *maxnodes,
+		const struct lctrie_build_opts *opts, int nthreads)
 {
-	node_lc *tmp = malloc(sizeof(node_lc));
-	if (NULL == node->left) {
-		tmp->subtrie = NULL;
-		tmp->skip = node->skip;
-		tmp->base = node->base;
-		tmp->branch = -1;
-		tmp->addr = -1;
-		tmp->child = -1;
-		free(node);
-		return tmp;
+	struct buildshared sh;
+	struct buildworker *workers;
+	struct buildframe *frames;
+	node_t *src;
+	int head = 0, top = 0, size = 64;
+	int rootbranch = opts->rootbranch;
+	int i, k, adr, shift;
+
+	frames = malloc(size * sizeof(struct buildframe));
+	pushframe(&frames, &top, &size, 0, 0, nbases, 0);
+	while (head < top && top - head < PARALLELSPLIT * nthreads) {
+		buildnode(base, lcp, frames[head++], rootbranch, trie, nnodes,
+				maxnodes, opts, &frames, &top, &size);
+		rootbranch = 0;
 	}
-	tmp->subtrie = malloc(2 * sizeof(node_lc *));
-	tmp->subtrie[0] = pattonewdata(node->left);
-	tmp->subtrie[1] = pattonewdata(node->right);
-	tmp->skip = node->skip;
-	tmp->base = node->base;
-	tmp->branch = -1;
-	tmp->addr = -1;
-	tmp->child = -1;
-	free(node);
-	return tmp;
+
+	sh.base = base;
+	sh.lcp = lcp;
+	sh.opts = opts;
+	sh.frames = frames + head;
+	sh.nframes = top - head;
+	sh.next = 0;
+	sh.owner = malloc(sh.nframes * sizeof(int));
+	sh.offset = malloc(sh.nframes * sizeof(int));
+	sh.count = malloc(sh.nframes * sizeof(int));
+
+	workers = malloc(nthreads * sizeof(struct buildworker));
+	for (i = 0; i < nthreads; i++) {
+		workers[i].id = i;
+		workers[i].shared = &sh;
+		workers[i].maxnodes = 2 * nbases / nthreads + 1;
+		workers[i].trie = malloc(workers[i].maxnodes * sizeof(node_t));
+		workers[i].nnodes = 0;
+		assert(0 == pthread_create(&workers[i].thread, NULL,
+					buildworker, &workers[i]));
+	}
+	for (i = 0; i < nthreads; i++)
+		assert(0 == pthread_join(workers[i].thread, NULL));
+
+	// Stitch the subtries to the top of the trie
+	for (i = 0; i < sh.nframes; i++) {
+		src = workers[sh.owner[i]].trie + sh.offset[i];
+		adr = allocnodes(trie, nnodes, maxnodes, sh.count[i] - 1);
+		shift = adr - (sh.offset[i] + 1);
+		(*trie)[sh.frames[i].pos] = movenode(src[0], shift);
+		for (k = 1; k < sh.count[i]; k++)
+			(*trie)[adr + k - 1] = movenode(src[k], shift);
+	}
+
+	for (i = 0; i < nthreads; i++)
+		free(workers[i].trie);
+	free(workers);
+	free(sh.owner);
+	free(sh.offset);
+	free(sh.count);
+	free(frames);
 }
 
 /*
- * Does the job of coverting a Patricia Trie to an LC-Trie in array
- * representation.
+ * Build the direct-index front table of the table t with an entry for each
+ * value v of the first dirbits bits of an XID
  *
- * root: the address of the root of the Patricia Trie
- * table: the address of the array where the LC-Trie is to be stored
- * n: total number of nodes in the LC-Trie i.e total number of nodes present in
- * table
+ * The entry holds the node a lookup starting with v reaches when the next
+ * branch would need bits past the first dirbits, and the position of that
+ * branch. If the node is a leaf whose answer does not depend on any later
+ * bit, either because its XID differs from v or because it is no longer than
+ * dirbits, the entry holds the answer instead.
  */
-static int pattolc(node_patric *root, node_t *table, int *n)
+static node_t *builddir(routtable_t t, int dirbits)
 {
-	node_lc *newroot = NULL;
-	newroot = pattonewdata(root);
-	newroot->branch = branchcompute(newroot);
-	updatebranch(newroot);
-	compresspattolc(newroot);
-	lltoarray(newroot, table, n);
+	struct xid_words w = {0, 0, 0};
+	node_t *dir, node;
+	uint32_t v, adr;
+	int pos, branch, lcp;
+	xid q;
+
+	assert(0 == posix_memalign((void **) &dir, 64,
+				sizeof(node_t) << dirbits));
+	for (v = 0; v < (1U << dirbits); v++) {
+		// q is v followed by zeros
+		w.hi = (uint64_t) v << (64 - dirbits);
+		xid_store(&q, &w);
+
+		node = t->trie[0];
+		pos = GETSKIP(node);
+		while ((branch = GETBRANCH(node)) && pos + branch <= dirbits) {
+			node = t->trie[GETADR(node) +
+				xid_bits_u32(&q, pos, branch)];
+			pos += branch + GETSKIP(node);
+		}
+
+		if (0 == GETBRANCH(node)) {
+			adr = GETADR(node);
+			lcp = xid_lcp(&t->base[adr].str, &q);
+			lcp = lcp < dirbits ? lcp : dirbits;
+			if (lcp < dirbits || t->base[adr].len <= dirbits) {
+				dir[v] = DIRRESOLVED | matchbase(lcp, adr, t);
+				continue;
+			}
+		}
+		dir[v] = node | (node_t) pos << 48;
+	}
+	return dir;
 }
 
 /*
@@ -475,91 +484,97 @@ static int pattolc(node_patric *root, node_t *table, int *n)
  */
 int isprefix(entry_t s, entry_t t)
 {
-	int tmp = 0;
-	int equal = -1;
 	int length;	//Represents the length of the prefix in the routing entry "s"
-	xid s_data, t_data;
-	xid *ps_data = &s_data;
-	xid *pt_data = &t_data;
 
 	if (NULL == s)
-		return tmp;
+		return 0;
 
 	length = s->len;
-	s_data = extract(0, length, s->data);
-	t_data = extract(0, length, t->data);
-	equal = comparexid(&ps_data, &pt_data);
-	tmp = ((0 == length) || ((length <= t->len) && (0 == equal)));
-	return tmp;
+	return ((0 == length) || ((length <= t->len) &&
+			(xid_lcp(&s->data, &t->data) >= length)));
 }
 
-int compare(const void * a, const void * b)
+/*
+ * Allocate the prefix vector for npre next-hops that are at most maxnexthop
+ */
+static void allocprefixes(comp_pre_t *pre, int npre, unsigned int maxnexthop)
 {
-	return ( *(unsigned int*)a - *(unsigned int*)b );
+	if (maxnexthop <= UINT8_MAX)
+		pre->nhwidth = sizeof(uint8_t);
+	else if (maxnexthop <= UINT16_MAX)
+		pre->nhwidth = sizeof(uint16_t);
+	else
+		pre->nhwidth = sizeof(uint32_t);
+	pre->nexthop = malloc(npre * pre->nhwidth);
 }
 
 /*
- * This routine builds the nexthop table that contains nexthop XIDs in a sorted
- * fashion. The duplicate addresses are removed and this table returns a
- * pointer to the first address of an array containing the nexthop xids.
- *
- * entry: array of entryrec pointers
- * nentries: number of total entries
- * nexthopsize: contains size of nexthop table
+ * Store the next-hop of entry i of the prefix vector
  */
-static unsigned int *buildnexthoptable(entry_t entry[], int nentries, int *nexthopsize)
+static void setprenexthop(comp_pre_t *pre, int i, unsigned int nexthop)
 {
-	unsigned int *nexthop = NULL;
-	unsigned int *tmpnext = malloc(nentries * sizeof(unsigned int));
-	int count, i;
-
-	//Extract the nexthop addresses from the entry array
-	for (i = 0; i < nentries; i++)
-		tmpnext[i] = entry[i]->nexthop;
-
-	qsort(tmpnext, nentries, sizeof(unsigned int), compare);
-
-	//Remove duplicates
-	count = nentries > 0 ? 1 : 0;
-	for (i = 1; i < nentries; i++) {
-		if (tmpnext[i - 1] != tmpnext[i])
-			tmpnext[count++] = tmpnext[i];
+	switch (pre->nhwidth) {
+	case 1:
+		((uint8_t *) pre->nexthop)[i] = nexthop;
+		break;
+	case 2:
+		((uint16_t *) pre->nexthop)[i] = nexthop;
+		break;
+	default:
+		((uint32_t *) pre->nexthop)[i] = nexthop;
+		break;
 	}
-
-	//Move the elements to an array of proper size
-	nexthop = malloc(count * sizeof(unsigned int));
-	for (i = 0; i < count; i++)
-		nexthop[i] = tmpnext[i];
-
-	free(tmpnext);
-
-	*nexthopsize = count;
-	return nexthop;
 }
 
 /*
  * This routine builds the entire routing table
+ *
+ * entry: array of entryrec pointers
+ * nentries: number of total entries
+ * opts: build options, NULL for the defaults in lc_trie.h
  */
-routtable_t buildrouttable(entry_t entry[], int nentries)
+routtable_t buildrouttable(entry_t entry[], int nentries,
+		const struct lctrie_build_opts *opts)
 {
-	unsigned int *nexthop; // Nexthop table
-	int nnexthops;
-	
+	const struct lctrie_build_opts defaults = {
+		.fillfactor = LCTRIE_FILLFACTOR,
+		.rootbranch = LCTRIE_ROOTBRANCH,
+		.maxbranch = LCTRIE_MAXBRANCH,
+		.nthreads = LCTRIE_NTHREADS,
+		.dirbits = LCTRIE_DIRBITS,
+	};
+
 	base_t *b, btemp;
 	pre_t *p, ptemp;
+	struct baserec *brecs;
+	struct prerec *precs;
 
 	node_t *trie;
 	comp_base_t *base;
-	comp_pre_t *pre;
+	comp_premap_t *premap;
+	comp_pre_t pre;
 	
 	routtable_t table = NULL;  // The complete data structure
 
 	// Auxiliary variables
-	int i, j, nprefs = 0, nbases = 0, *tmp_val = NULL;
-
-	nexthop = buildnexthoptable(entry, nentries, &nnexthops);
-
-	xidentrysort(entry, nentries, sizeof(entry_t), compareentries);
+	int i, j, nprefs = 0, nbases = 0, npre, depth, q;
+	int nnodes, maxnodes;
+	unsigned int maxnexthop = 0;
+	uint8_t *lcp;
+	struct buildframe root = {0, 0, 0, 0};
+	int nthreads;
+
+	if (NULL == opts)
+		opts = &defaults;
+	assert(opts->fillfactor > 0 && opts->fillfactor <= 1);
+	assert(opts->rootbranch >= 0 && opts->rootbranch <= MAXBRANCH);
+	assert(opts->maxbranch >= 1 && opts->maxbranch <= MAXBRANCH);
+	assert(opts->dirbits >= 0 && opts->dirbits <= MAXDIRBITS);
+	nthreads = opts->nthreads > 0 ? opts->nthreads :
+			sysconf(_SC_NPROCESSORS_ONLN);
+
+	xidentrysort_parallel(entry, nentries, sizeof(entry_t), compareentries,
+			nthreads);
 	// Remove duplicates
 /*	size = nentries > 0 ? 1 : 0;
 	for (i = 1; i < nentries; i++) {
@@ -571,6 +586,8 @@ routtable_t buildrouttable(entry_t entry[], int nentries)
 	// than the number of entries.
 	b = (base_t *) malloc(nentries * sizeof(base_t));
 	p = (pre_t *) malloc(nentries * sizeof(pre_t));
+	brecs = malloc(nentries * sizeof(struct baserec));
+	precs = malloc(nentries * sizeof(struct prerec));
 
 	//Initialize pre-pointers
 	for (i = 0; i < nentries; i++)
@@ -580,68 +597,116 @@ routtable_t buildrouttable(entry_t entry[], int nentries)
 	//and the rest of the strings in b
 	for (i = 0; i < nentries; i++) {
 		if (i < nentries - 1 && isprefix(entry[i], entry[i + 1])) {
-			ptemp = (pre_t) malloc(sizeof(struct prerec));
+			ptemp = &precs[nprefs];
 			ptemp->len = entry[i]->len;
 			ptemp->pre = entry[i]->pre;
 			//Update 'pre' for all entries that have this prefix
 			for (j = i + 1; j < nentries && isprefix(entry[i], entry[j]); j++)
 					entry[j]->pre = nprefs;
-			tmp_val = bsearch(&entry[i]->nexthop, nexthop,
-				nnexthops, sizeof(unsigned int), compare);
-			ptemp->nexthop = *tmp_val;
+			ptemp->nexthop = entry[i]->nexthop;
+			if (ptemp->nexthop > maxnexthop)
+				maxnexthop = ptemp->nexthop;
 			p[nprefs++] = ptemp;
 		} else {
-			btemp = (base_t) malloc(sizeof(struct baserec));
+			btemp = &brecs[nbases];
 			btemp->len = entry[i]->len;
 			btemp->str = entry[i]->data;
 			btemp->pre = entry[i]->pre;
-			tmp_val = bsearch(&entry[i]->nexthop, nexthop,
-				nnexthops, sizeof(unsigned int), compare);
-			btemp->nexthop = *tmp_val;
+			btemp->nexthop = entry[i]->nexthop;
 			b[nbases++] = btemp;
 		}
 	}
 
-	node_patric *root;
-	root = buildpatricia(b, 0, 0, nbases);
-	node_t *lctable = malloc(sizeof(node_t) * (2 * nbases - 1));
-	int nnode_lc;
-	pattolc(root, lctable, &nnode_lc);
+	//A trie with complete levels only never has more than 2 * nbases - 1
+	//nodes, buildtrie() grows the array when the fill factor allows more
+	maxnodes = 2 * nbases;
+	trie = malloc(maxnodes * sizeof(node_t));
+	nnodes = 0;
+	allocnodes(&trie, &nnodes, &maxnodes, 1);
+	lcp = malloc(nbases * sizeof(uint8_t));
+	for (i = 0; i < nbases - 1; i++)
+		lcp[i] = xid_lcp(&b[i]->str, &b[i + 1]->str);
+	if (nthreads > 1 && nbases >= PARALLELMIN) {
+		buildtrie_parallel(b, lcp, nbases, &trie, &nnodes, &maxnodes,
+				opts, nthreads);
+	} else {
+		root.n = nbases;
+		buildtrie(b, lcp, root, opts->rootbranch, &trie, &nnodes,
+				&maxnodes, opts);
+	}
+	free(lcp);
+	trie = realloc(trie, nnodes * sizeof(node_t));
+
+	//The prefixes of prefix i are the lengths in premap[i].premap and
+	//their next-hops start at entry premap[i].pre of the prefix vector.
+	//The prefixes of p are in depth-first order, so the first prefix
+	//child of a prefix comes right after it and extends its next-hops
+	//at the end of the prefix vector instead of copying them.
+	assert(0 == posix_memalign((void **) &premap, sizeof(comp_premap_t),
+				nprefs * sizeof(comp_premap_t)));
+	npre = 0;
+	for (i = 0; i < nprefs; i++) {
+		memset(&premap[i], 0, sizeof(comp_premap_t));
+		q = p[i]->pre;
+		depth = 1;
+		if (q != NOPRE) {
+			memcpy(premap[i].premap, premap[q].premap,
+					sizeof(premap[i].premap));
+			depth += xid_lenmap_rank(premap[q].premap, ADRSIZE);
+		}
+		xid_lenmap_set(premap[i].premap, p[i]->len);
+		if (q != NOPRE && premap[q].pre + depth - 1 == npre) {
+			premap[i].pre = premap[q].pre;
+			npre++;
+		} else {
+			premap[i].pre = npre;
+			npre += depth;
+		}
+	}
 
 	//At this point we now how much memory to allocate
-	trie = malloc(nnode_lc * sizeof(node_t));
-	base = malloc(nbases * sizeof(comp_base_t));
-	pre = malloc(nprefs * sizeof(comp_pre_t));
+	assert(0 == posix_memalign((void **) &base, sizeof(comp_base_t),
+				nbases * sizeof(comp_base_t)));
+	allocprefixes(&pre, npre, maxnexthop);
 
-	for (i = 0; i < nnode_lc; i++)
-		trie[i] = lctable[i];
-	free(lctable);
+	for (i = 0; i < nprefs; i++) {
+		q = p[i]->pre;
+		depth = xid_lenmap_rank(premap[i].premap, ADRSIZE);
+		if (q != NOPRE && premap[i].pre != premap[q].pre)
+			memcpy((char *) pre.nexthop +
+				premap[i].pre * pre.nhwidth,
+				(char *) pre.nexthop +
+				premap[q].pre * pre.nhwidth,
+				(depth - 1) * pre.nhwidth);
+		setprenexthop(&pre, premap[i].pre + depth - 1, p[i]->nexthop);
+	}
+	free(precs);
+	free(p);
 
 	for (i = 0; i < nbases; i++) {
+		memset(&base[i], 0, sizeof(comp_base_t));
 		base[i].str = b[i]->str;
 		base[i].len = b[i]->len;
 		base[i].pre = b[i]->pre;
 		base[i].nexthop = b[i]->nexthop;
-		free(b[i]);
 	}
+	free(brecs);
 	free(b);
 
-	for (i = 0; i < nprefs; i++) {
-		pre[i].len = p[i]->len;
-		pre[i].pre = p[i]->pre;
-		pre[i].nexthop = p[i]->nexthop;
-		free(p[i]);
-	}
-	free(p);
-
 	table = (routtable_t) malloc(sizeof(struct routtablerec));
 	table->trie = trie;
-	table->triesize = nnode_lc;
+	table->triesize = nnodes;
 	table->base = base;
 	table->basesize = nbases;
+	table->premap = premap;
+	table->premapsize = nprefs;
 	table->pre = pre;
-	table->presize = nprefs;
-	table->nexthop = nexthop;
-	table->nexthopsize = nnexthops;
+	table->presize = npre;
+	table->dir = NULL;
+	table->dirbits = opts->dirbits;
+	table->image = NULL;
+	table->imagesize = 0;
+	if (opts->dirbits > 0)
+		table->dir = builddir(table, opts->dirbits);
 	return table;
 }
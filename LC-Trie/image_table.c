@@ -0,0 +1,205 @@
+/*
+   Garnaik Sumeet, Michel Machado 2015
+   LPM Algorithms in Linux-XIA
+
+   A built LC-Trie saved as a single file that can be mapped and looked up
+   in place.
+
+   The file starts with a header followed by the trie array, the base vector,
+   the premap vector and the prefix vector, followed by the direct-index
+   front table if the LC-Trie has one, each array starting at a multiple of
+   IMAGEALIGN bytes.
+   The header refers to the arrays by their offset in the file, so mapping
+   the file only needs to check the header and set the pointers of a struct
+   routtablerec. The arrays are stored in the byte order and layout of the
+   host that wrote them, which the header records.
+*/
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lc_trie.h"
+
+#define IMAGEMAGIC "LCTRIE\0\0"
+#define IMAGEVERSION 1
+#define IMAGEBYTEORDER 0x01020304	/* reads differently on another host */
+#define IMAGEALIGN 64			/* alignment of every array */
+
+struct lctrie_image_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byteorder;
+	uint32_t nodesize;	//sizeof(node_t)
+	uint32_t basesize;	//sizeof(comp_base_t)
+	uint32_t premapsize;	//sizeof(comp_premap_t)
+	uint32_t nhwidth;	//Bytes per next-hop of the prefix vector
+	uint32_t dirbits;	//Bits indexing the front table, 0 if none
+	uint32_t pad;		//Zero, aligns the counts below
+	uint64_t ntrie;		//Number of nodes of the trie array
+	uint64_t nbase;		//Number of entries of the base vector
+	uint64_t npremap;	//Number of entries of the premap vector
+	uint64_t npre;		//Number of entries of the prefix vector
+	uint64_t trie;		//Offsets of the arrays in the file
+	uint64_t base;
+	uint64_t premap;
+	uint64_t pre;
+	uint64_t dir;
+	uint64_t size;		//Size of the file
+};
+
+static uint64_t imagealign(uint64_t off)
+{
+	return (off + IMAGEALIGN - 1) & ~(uint64_t) (IMAGEALIGN - 1);
+}
+
+/*
+ * Write len bytes of data at offset off of fp, zero filling the padding from
+ * the current position of fp, which is less than IMAGEALIGN bytes
+ */
+static int writeat(FILE *fp, uint64_t off, const void *data, size_t len)
+{
+	static const char zeros[IMAGEALIGN];
+	long pos = ftell(fp);
+
+	if (pos < 0 || pos > off || off - pos >= IMAGEALIGN)
+		return -1;
+	if (off > pos && 1 != fwrite(zeros, off - pos, 1, fp))
+		return -1;
+	if (len > 0 && 1 != fwrite(data, len, 1, fp))
+		return -1;
+	return 0;
+}
+
+/*
+ * Write the table t to the file at path. Return 0 on success and -1 on an
+ * error, in which case the file is removed.
+ */
+int lctrie_save(routtable_t t, const char *path)
+{
+	struct lctrie_image_header h;
+	FILE *fp;
+	int err = 0;
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, IMAGEMAGIC, sizeof(h.magic));
+	h.version = IMAGEVERSION;
+	h.byteorder = IMAGEBYTEORDER;
+	h.nodesize = sizeof(node_t);
+	h.basesize = sizeof(comp_base_t);
+	h.premapsize = sizeof(comp_premap_t);
+	h.nhwidth = t->pre.nhwidth;
+	h.ntrie = t->triesize;
+	h.nbase = t->basesize;
+	h.npremap = t->premapsize;
+	h.npre = t->presize;
+	h.trie = imagealign(sizeof(h));
+	h.base = imagealign(h.trie + h.ntrie * sizeof(node_t));
+	h.premap = imagealign(h.base + h.nbase * sizeof(comp_base_t));
+	h.pre = imagealign(h.premap + h.npremap * sizeof(comp_premap_t));
+	h.dirbits = t->dir ? t->dirbits : 0;
+	h.dir = imagealign(h.pre + h.npre * h.nhwidth);
+	h.size = h.dir + (h.dirbits ? sizeof(node_t) << h.dirbits : 0);
+
+	fp = fopen(path, "wb");
+	if (NULL == fp)
+		return -1;
+	err |= writeat(fp, 0, &h, sizeof(h));
+	err |= writeat(fp, h.trie, t->trie, h.ntrie * sizeof(node_t));
+	err |= writeat(fp, h.base, t->base, h.nbase * sizeof(comp_base_t));
+	err |= writeat(fp, h.premap, t->premap,
+			h.npremap * sizeof(comp_premap_t));
+	err |= writeat(fp, h.pre, t->pre.nexthop, h.npre * h.nhwidth);
+	err |= writeat(fp, h.dir, t->dir, h.size - h.dir);
+	err |= fclose(fp);
+	if (err) {
+		unlink(path);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Check that the header h describes an image of size bytes that this host can
+ * look up in place
+ */
+static int checkheader(const struct lctrie_image_header *h, uint64_t size)
+{
+	if (size < sizeof(*h) || memcmp(h->magic, IMAGEMAGIC, sizeof(h->magic)))
+		return -1;
+	if (h->version != IMAGEVERSION || h->byteorder != IMAGEBYTEORDER ||
+			h->nodesize != sizeof(node_t) ||
+			h->basesize != sizeof(comp_base_t) ||
+			h->premapsize != sizeof(comp_premap_t))
+		return -1;
+	if (h->nhwidth != 1 && h->nhwidth != 2 && h->nhwidth != 4)
+		return -1;
+	if (h->dirbits > MAXDIRBITS)
+		return -1;
+	if (h->size != size || h->ntrie < 1 || h->ntrie > UINT32_MAX ||
+			h->nbase > INT32_MAX || h->npremap > INT32_MAX ||
+			h->npre > INT32_MAX)
+		return -1;
+	if (h->trie + h->ntrie * sizeof(node_t) > h->base ||
+			h->base + h->nbase * sizeof(comp_base_t) > h->premap ||
+			h->premap + h->npremap * sizeof(comp_premap_t) >
+				h->pre ||
+			h->pre + h->npre * h->nhwidth > h->dir ||
+			h->dir + (h->dirbits ? sizeof(node_t) << h->dirbits :
+				0) > size)
+		return -1;
+	if (h->trie % IMAGEALIGN || h->base % IMAGEALIGN ||
+			h->premap % IMAGEALIGN || h->pre % IMAGEALIGN ||
+			h->dir % IMAGEALIGN)
+		return -1;
+	return 0;
+}
+
+/*
+ * Map the file at path written by lctrie_save() read-only and return the
+ * table it holds, or NULL if it cannot be mapped or was not written by a
+ * compatible build. The table is released with lctrie_destroy_fib().
+ */
+routtable_t lctrie_map(const char *path)
+{
+	const struct lctrie_image_header *h;
+	routtable_t t;
+	struct stat st;
+	char *image;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) < 0 || st.st_size < sizeof(*h)) {
+		close(fd);
+		return NULL;
+	}
+	image = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (MAP_FAILED == image)
+		return NULL;
+
+	h = (const struct lctrie_image_header *) image;
+	if (checkheader(h, st.st_size)) {
+		munmap(image, st.st_size);
+		return NULL;
+	}
+
+	t = malloc(sizeof(struct routtablerec));
+	t->trie = (node_t *) (image + h->trie);
+	t->triesize = h->ntrie;
+	t->base = (comp_base_t *) (image + h->base);
+	t->basesize = h->nbase;
+	t->premap = (comp_premap_t *) (image + h->premap);
+	t->premapsize = h->npremap;
+	t->pre.nexthop = image + h->pre;
+	t->pre.nhwidth = h->nhwidth;
+	t->presize = h->npre;
+	t->dir = h->dirbits ? (node_t *) (image + h->dir) : NULL;
+	t->dirbits = h->dirbits;
+	t->image = image;
+	t->imagesize = st.st_size;
+	return t;
+}
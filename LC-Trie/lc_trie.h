@@ -35,11 +35,11 @@
 #include <float.h>
 #include <stdint.h>
 #include "generate_fibs.h"
+#include "../XID-Kernel/xid_kernel.h"
 
 
 #define ADRSIZE 160       /* the number of bits in an address */
 
-typedef struct xid { unsigned char w[20]; } xid;
 typedef xid *list;
 
 typedef uint64_t word;
@@ -52,6 +52,14 @@ typedef word node_t;
 #define GETSKIP(node)		((node) << 24 >> 56)
 #define GETADR(node)		((node) << 32 >> 32)
 
+/*
+ * An entry of the direct-index front table is either a trie node with the
+ * position of its branch bits in bits 48-55, or a next-hop flagged with
+ * DIRRESOLVED
+ */
+#define GETPOS(entry)		((entry) << 8 >> 56)
+#define DIRRESOLVED		((node_t) 1 << 63)
+
 /* The routing table entries are initially stored in
    a simple array */
 
@@ -72,17 +80,34 @@ struct baserec
 	xid str;    /* the routing entry */
 	int len;     /* and its length */
 	int pre;     /* pointer to prefix table, -1 if no prefix */
-	int nexthop; /* pointer to next-hop table */
+	unsigned int nexthop; /* the next-hop */
 };
 
-/* compact version of above */
+/*
+ * compact version of above, aligned so that the check of a hit only reads one
+ * cache line and finds the next-hop there. On a miss, entry pre of the premap
+ * vector holds the prefixes of str.
+ */
 typedef struct
 {
 	xid str;
-	int len;
-	int pre;
-	int nexthop;
-} comp_base_t;
+	uint8_t len;
+	int pre;	/* entry of the premap vector, NOPRE if no prefix */
+	unsigned int nexthop;
+} __attribute__((aligned(32))) comp_base_t;
+
+/*
+ * The prefixes of a prefix, itself included, kept out of the base vector so
+ * that the entries without prefixes stay 32 bytes. premap holds their lengths
+ * and the longest one that matches is selected with xid_lenmap_rank(). Their
+ * next-hops are stored in increasing length order from entry pre of the
+ * prefix vector.
+ */
+typedef struct
+{
+	uint64_t premap[XID_LENMAP_WORDS];
+	int pre;	/* first next-hop of the prefixes */
+} __attribute__((aligned(32))) comp_premap_t;
 
 /* prefix vector */
 
@@ -91,19 +116,25 @@ struct prerec
 {
 	int len;     /* the length of the prefix */
 	int pre;     /* pointer to prefix, -1 if no prefix */
-	int nexthop; /* pointer to nexthop table */
+	unsigned int nexthop; /* the next-hop */
 };
 
-/* compact version of above */
+/*
+ * compact version of above, which only keeps the next-hops. The next-hops of
+ * the prefixes of every prefix, followed by its own one, are in consecutive
+ * entries in increasing length order. A prefix shares these entries with its
+ * first prefix child, which only adds its own next-hop after them, and the
+ * other children copy them. The next-hops take the fewest bytes that hold the
+ * largest of them.
+ */
 typedef struct
 {
-	int len;
-	int pre;
-	int nexthop;
+	void *nexthop;	/* nhwidth bytes per next-hop */
+	int nhwidth;	/* 1, 2 or 4 */
 } comp_pre_t;
 
 /* The complete routing table data structure consists of
-   a trie, a base vector, a prefix vector, and a next-hop table. */
+   a trie, a base vector, a premap vector and a prefix vector. */
 
 typedef struct routtablerec *routtable_t;
 struct routtablerec
@@ -112,71 +143,124 @@ struct routtablerec
 	int triesize;
 	comp_base_t *base;    /* the base vector */
 	int basesize;
-	comp_pre_t *pre;      /* the prefix vector */
+	comp_premap_t *premap; /* the premap vector */
+	int premapsize;
+	comp_pre_t pre;       /* the prefix vector */
 	int presize;
-	unsigned int *nexthop;   /* the next-hop table */
-	int nexthopsize;
+	node_t *dir;          /* the direct-index front table, NULL if none */
+	int dirbits;          /* number of XID bits that index it */
+	void *image;          /* the file mapping holding the vectors, NULL */
+	size_t imagesize;     /* if they were built in memory */
 };
 
-/*
- * The structure of each node for building the path compressed trie from XIDs
- */
-typedef struct node_patric node_patric;
-struct node_patric
+/* Read the next-hop of entry i of the prefix vector */
+static inline unsigned int getprenexthop(const comp_pre_t *pre, int i)
 {
-	int skip;	//The number of bits skipped
-	node_patric *left;	//Pointer to left node in Patricia Trie
-	node_patric *right;	//Pointer to right node in Patricia Trie
-	int base;	//The address of the XID in base vector
-};
+	switch (pre->nhwidth) {
+	case 1:
+		return ((const uint8_t *) pre->nexthop)[i];
+	case 2:
+		return ((const uint16_t *) pre->nexthop)[i];
+	default:
+		return ((const uint32_t *) pre->nexthop)[i];
+	}
+}
 
-/* The structure of each node for building the level compressed trie */
-typedef struct node_lc node_lc;
-struct node_lc
+/*
+ * Options for building the LC-Trie. A lower fill factor and a large root
+ * branch make the trie shallower at the cost of memory for empty children.
+ */
+struct lctrie_build_opts
 {
-	int skip;	//The number of bits skipped
-	node_lc **subtrie;	//Array of pointers to nodes in the trie
-	int base;	//The address of the XID in base vector
-	int branch;	//Branching factor i.e number of children = 2^branch
-	int addr;	//Address of the node in array representation
-	int child;	//Address of the left most child node in array representation
+	double fillfactor;	/* fraction of the children of a node, (0, 1], */
+				/* that must hold XIDs */
+	int rootbranch;		/* branching factor of the root, 0 to compute it */
+				/* like for every other node */
+	int maxbranch;		/* largest branching factor of any other node */
+	int nthreads;		/* threads sorting the entries and building the */
+				/* trie, 0 for one per online CPU */
+	int dirbits;		/* bits of the XID indexing a direct-index table */
+				/* in front of the trie, 0 for no table */
 };
 
-/* Extract operation for xids*/
-xid extract(int pos, int length, xid data);
-
-/* Remove bits from xids*/
-xid removexid(int bits, xid data);
+#define LCTRIE_FILLFACTOR 1.0	/* only compress complete levels */
+#define LCTRIE_ROOTBRANCH 0
+#define LCTRIE_MAXBRANCH 16
+#define LCTRIE_NTHREADS 0
+#define LCTRIE_DIRBITS 0
+#define MAXDIRBITS 20		/* largest direct-index table that can be built */
+#define MAXBRANCH 24		/* largest branching factor that can be built */
 
 /* Increment xids*/
 int incrementxid(xid *pxid);
 
-/* Bitwise shifting operations on xids*/
-xid shift_left(xid id, int shift);
-xid shift_right(xid id, int shift);
-
 /* Build the routing table */
-routtable_t buildrouttable(entry_t entry[], int nentries);
+routtable_t buildrouttable(entry_t entry[], int nentries,
+		const struct lctrie_build_opts *opts);
 
 struct routtablerec *lctrie_create_fib(struct nextcreate *table,
 		unsigned long size);
 
+struct routtablerec *lctrie_create_fib_opts(struct nextcreate *table,
+		unsigned long size, const struct lctrie_build_opts *opts);
+
 int lctrie_destroy_fib(struct routtablerec *rtable);
 
 unsigned int lctrie_lookup(const xid *id, routtable_t table);
 
-/* 
- * Extract the 32 LSBs and cast to uint32_t
- */
-uint32_t xidtounsigned(xid *bitpat);
-
-/* 
- * Compare XIDs and return 0, 1, -1 depending on the values pointed by
- * dereferencing id1 and id2 twice.
- */
-int comparexid(const void *id1, const void *id2);
+/* Perform n independent lookups with their memory accesses overlapped */
+void lctrie_lookup_batch(const xid *ids, unsigned n, unsigned *nexthops,
+		routtable_t t);
 
 /* Perform a lookup. */
 unsigned int find(const xid *s, routtable_t t);
 
+/* Check the base vector entry where a lookup of s ends */
+unsigned int findbase(const xid *s, uint32_t adr, routtable_t t);
+
+/* Same as findbase() when s and the entry have the first lcp bits in common */
+unsigned int matchbase(int lcp, uint32_t adr, routtable_t t);
+
+/* In update_table.c */
+
+/*
+ * An LC-Trie split into slices by the first bits of the routes, where each
+ * slice can be rebuilt and replaced while lookups run
+ */
+struct lctrie_dyntable;
+
+#define LCTRIE_INSERT 0
+#define LCTRIE_DELETE 1
+
+/* A route change for lctrie_apply_updates() */
+struct lctrie_update
+{
+	int op;			/* LCTRIE_INSERT or LCTRIE_DELETE */
+	xid prefix;
+	int len;
+	unsigned int nexthop;	/* ignored by LCTRIE_DELETE */
+};
+
+struct lctrie_dyntable *lctrie_dyn_create(struct nextcreate *table,
+		unsigned long size, int rootbits,
+		const struct lctrie_build_opts *opts);
+int lctrie_dyn_destroy(struct lctrie_dyntable *t);
+int lctrie_apply_updates(struct lctrie_dyntable *t,
+		const struct lctrie_update *u, int n);
+int lctrie_insert(struct lctrie_dyntable *t, const xid *prefix, int len,
+		unsigned int nexthop);
+int lctrie_delete(struct lctrie_dyntable *t, const xid *prefix, int len);
+unsigned int lctrie_dyn_lookup(const xid *id, struct lctrie_dyntable *t);
+
+/* Free the LC-Tries replaced by updates once no lookup can still use them */
+int lctrie_dyn_reclaim(struct lctrie_dyntable *t);
+
+/* In image_table.c */
+
+/* Write the table to a file that lctrie_map() can map */
+int lctrie_save(routtable_t t, const char *path);
+
+/* Map a table written by lctrie_save() read-only */
+routtable_t lctrie_map(const char *path);
+
 #endif // _LC_TRIE_H_
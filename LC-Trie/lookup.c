@@ -28,53 +28,60 @@
 /* Return a nexthop or 0 if not found */
 unsigned int find(const xid *s, routtable_t t)
 {
-	int i,val;
 	node_t node;
 	unsigned char pos, branch;
 	uint32_t adr, next_jump;
-	xid *bitmask = malloc(sizeof(xid));
-	xid *tmp = malloc(sizeof(xid));
-	xid tmp_node;
-	int preadr;
+
+	/* Start from the front table if there is one */
+	if (t->dir) {
+		node = t->dir[xid_bits_u32(s, 0, t->dirbits)];
+		if (node & DIRRESOLVED)
+			return (unsigned int) node;
+		pos = (unsigned char) GETPOS(node);
+	} else {
+		node = t->trie[0];
+		pos = (unsigned char) GETSKIP(node);
+	}
 
 	/* Traverse the trie */
-	node = t->trie[0];
-	pos = (unsigned char) GETSKIP(node);
 	branch = (unsigned char) GETBRANCH(node);
 	adr = (uint32_t) GETADR(node);
 	while (branch != 0) {
-		tmp_node = extract(pos, branch, *s);
-		next_jump = xidtounsigned(&tmp_node);
+		next_jump = xid_bits_u32(s, pos, branch);
 		node = t->trie[adr + next_jump];
 		pos += branch + GETSKIP(node);
 		branch = (unsigned char) GETBRANCH(node);
-		adr = (unsigned char) GETADR(node);
+		adr = (uint32_t) GETADR(node);
 	}
 
-	/* Was this a hit? */
-	for (i = 0; i < 20; i++)
-		bitmask->w[i] = (t->base[adr].str).w[i] ^ s->w[i];
-	*bitmask = extract(0, t->base[adr].len, *bitmask);
-	memset(tmp, 0, 20);
-	val = comparexid(&bitmask, &tmp);
-	if (0 == val) {
-		free(bitmask);
-		free(tmp);
-		return t->nexthop[t->base[adr].nexthop];
-	}
+	return findbase(s, adr, t);
+}
 
-	/* If not, look in the prefix tree */
-	preadr = t->base[adr].pre;
-	while (preadr != NOPRE) {
-		*bitmask = extract(0, t->pre[preadr].len, *bitmask);
-		val = comparexid(&bitmask, &tmp);
-		if (0 == val) {
-			free(bitmask);
-			free(tmp);
-			return t->nexthop[t->pre[preadr].nexthop];
-		}
-		preadr = t->pre[preadr].pre;
-	}
+/*
+ * Return the nexthop of the longest prefix in the base vector entry adr, or
+ * among its prefixes, that matches s or 0 if none does
+ */
+unsigned int findbase(const xid *s, uint32_t adr, routtable_t t)
+{
+	return matchbase(xid_lcp(&t->base[adr].str, s), adr, t);
+}
+
+unsigned int matchbase(int lcp, uint32_t adr, routtable_t t)
+{
+	const comp_base_t *b = &t->base[adr];
+	const comp_premap_t *m;
+	int rank;
+
+	/* Was this a hit? */
+	if (lcp >= b->len)
+		return b->nexthop;
 
-	return 0; //Not found
+	/* If not, select the longest of its prefixes that matches */
+	if (NOPRE == b->pre)
+		return 0; //Not found
+	m = &t->premap[b->pre];
+	rank = xid_lenmap_rank(m->premap, lcp);
+	if (0 == rank)
+		return 0; //Not found
+	return getprenexthop(&t->pre, m->pre + rank - 1);
 }
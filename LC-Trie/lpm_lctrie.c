@@ -5,6 +5,7 @@
 
 #include "lpm_lctrie.h"
 #include <assert.h>
+#include <sys/mman.h>
 
 static int fib_format(entry_t entry[], struct nextcreate *table,
 		unsigned long size)
@@ -22,6 +23,12 @@ static int fib_format(entry_t entry[], struct nextcreate *table,
 
 struct routtablerec *lctrie_create_fib(struct nextcreate *table,
 		unsigned long size)
+{
+	return lctrie_create_fib_opts(table, size, NULL);
+}
+
+struct routtablerec *lctrie_create_fib_opts(struct nextcreate *table,
+		unsigned long size, const struct lctrie_build_opts *opts)
 {
 	entry_t *entry = malloc(size * sizeof(entry_t));
 	int nentries;
@@ -33,22 +40,166 @@ struct routtablerec *lctrie_create_fib(struct nextcreate *table,
 		entry[i] = (tmp_entry + i);
 	assert(0 == fib_format(entry, table, size));
 
-	fib = buildrouttable(entry, size);
+	fib = buildrouttable(entry, size, opts);
+	free(tmp_entry);
 	free(entry);
 	return fib;
 }
 
 int lctrie_destroy_fib(struct routtablerec *rtable)
 {
+	if (rtable->image) {
+		assert(0 == munmap(rtable->image, rtable->imagesize));
+		free(rtable);
+		return 0;
+	}
+
 	free(rtable->trie);
 	free(rtable->base);
-	free(rtable->nexthop);
+	free(rtable->premap);
+	free(rtable->pre.nexthop);
+	free(rtable->dir);
 	free(rtable);
 
 	return 0;
 }
 
+/*
+ * Compute the shape of the LC-Trie. The depth of a lookup is the number of
+ * trie nodes it reads after the root, or after its entry of the front table,
+ * and the depths are averaged over lookups of the XIDs in the base vector so
+ * that children without XIDs do not count. The front table is counted in
+ * triebytes.
+ */
+int lctrie_stat(routtable_t t, struct lctrie_stat *st)
+{
+	node_t node;
+	unsigned char pos, branch;
+	int i, depth;
+
+	st->avgdepth = 0;
+	st->maxdepth = 0;
+	for (i = 0; i < t->basesize; i++) {
+		if (t->dir) {
+			// A lookup resolved by the front table reads no node
+			node = t->dir[xid_bits_u32(&t->base[i].str, 0,
+					t->dirbits)];
+			if (node & DIRRESOLVED)
+				continue;
+			pos = (unsigned char) GETPOS(node);
+		} else {
+			node = t->trie[0];
+			pos = (unsigned char) GETSKIP(node);
+		}
+		branch = (unsigned char) GETBRANCH(node);
+		for (depth = 0; branch != 0; depth++) {
+			node = t->trie[GETADR(node) +
+				xid_bits_u32(&t->base[i].str, pos, branch)];
+			pos += branch + GETSKIP(node);
+			branch = (unsigned char) GETBRANCH(node);
+		}
+		st->avgdepth += depth;
+		if (depth > st->maxdepth)
+			st->maxdepth = depth;
+	}
+	if (t->basesize > 0)
+		st->avgdepth /= t->basesize;
+	st->triebytes = t->triesize * sizeof(node_t);
+	if (t->dir)
+		st->triebytes += sizeof(node_t) << t->dirbits;
+	st->bytes = st->triebytes + t->basesize * sizeof(comp_base_t) +
+			t->premapsize * sizeof(comp_premap_t) +
+			t->presize * t->pre.nhwidth;
+
+	return 0;
+}
+
 unsigned int lctrie_lookup(const xid *id, routtable_t table)
 {
 	return find(id, table);
 }
+
+/*
+ * Look up ids[0..n-1] and store their nexthops in nexthops[0..n-1].
+ *
+ * The lookups are taken LCTRIE_BATCH at a time and the whole group is moved
+ * down the trie one level per pass. The node each lookup reads in the next
+ * pass, and the base vector entry once it reaches a leaf, is prefetched in
+ * this pass, so the cache misses of the group are served in parallel instead
+ * of one after the other as in find().
+ */
+void lctrie_lookup_batch(const xid *ids, unsigned n, unsigned *nexthops,
+		routtable_t t)
+{
+	node_t node;
+	uint32_t adr[LCTRIE_BATCH];
+	unsigned char pos[LCTRIE_BATCH];
+	unsigned char branch[LCTRIE_BATCH];
+	unsigned char resolved[LCTRIE_BATCH];
+	const xid *s;
+	unsigned int g, i, m, active;
+
+	for (g = 0; g < n; g += LCTRIE_BATCH) {
+		s = ids + g;
+		m = n - g < LCTRIE_BATCH ? n - g : LCTRIE_BATCH;
+
+		// The lookups start at the root, or at their entry of the front
+		// table if there is one. While branch is not 0, adr is the
+		// address of the next node to be read by that lookup.
+		if (t->dir) {
+			for (i = 0; i < m; i++)
+				__builtin_prefetch(&t->dir[xid_bits_u32(&s[i], 0,
+							t->dirbits)]);
+		}
+		node = t->trie[0];
+		active = 0;
+		for (i = 0; i < m; i++) {
+			resolved[i] = 0;
+			if (t->dir) {
+				node = t->dir[xid_bits_u32(&s[i], 0, t->dirbits)];
+				if (node & DIRRESOLVED) {
+					nexthops[g + i] = (unsigned int) node;
+					resolved[i] = 1;
+					branch[i] = 0;
+					continue;
+				}
+				pos[i] = (unsigned char) GETPOS(node);
+			} else {
+				pos[i] = (unsigned char) GETSKIP(node);
+			}
+			branch[i] = (unsigned char) GETBRANCH(node);
+			adr[i] = (uint32_t) GETADR(node);
+			if (0 == branch[i]) {
+				__builtin_prefetch(&t->base[adr[i]]);
+				continue;
+			}
+			adr[i] += xid_bits_u32(&s[i], pos[i], branch[i]);
+			__builtin_prefetch(&t->trie[adr[i]]);
+			active++;
+		}
+
+		while (active) {
+			active = 0;
+			for (i = 0; i < m; i++) {
+				if (0 == branch[i])
+					continue;
+				node = t->trie[adr[i]];
+				pos[i] += branch[i] + GETSKIP(node);
+				branch[i] = (unsigned char) GETBRANCH(node);
+				adr[i] = (uint32_t) GETADR(node);
+				if (0 == branch[i]) {
+					__builtin_prefetch(&t->base[adr[i]]);
+					continue;
+				}
+				adr[i] += xid_bits_u32(&s[i], pos[i], branch[i]);
+				__builtin_prefetch(&t->trie[adr[i]]);
+				active++;
+			}
+		}
+
+		for (i = 0; i < m; i++) {
+			if (!resolved[i])
+				nexthops[g + i] = findbase(&s[i], adr[i], t);
+		}
+	}
+}
@@ -17,10 +17,19 @@
 
 #define MINLENGTH 20
 #define MAXLENGTH 159
+#define LCTRIE_BATCH 16 /* Lookups advanced together by lctrie_lookup_batch() */
+
+/* The shape of an LC-Trie as computed by lctrie_stat() */
+struct lctrie_stat {
+	double avgdepth;		/* average depth of a lookup */
+	int maxdepth;			/* depth of the deepest lookup */
+	unsigned long triebytes;	/* memory taken by the trie array */
+	unsigned long bytes;		/* memory taken by all the vectors */
+};
 
 struct routtablerec *lctrie_create_fib(struct nextcreate *table,
 		unsigned long size);
-unsigned int lookup_bloom(const xid *id, routtable_t table);
 int lctrie_destroy_fib(struct routtablerec *rtable);
+int lctrie_stat(routtable_t t, struct lctrie_stat *st);
 
 #endif
@@ -0,0 +1,373 @@
+/*
+   Garnaik Sumeet, Michel Machado 2015
+   LPM Algorithms in Linux-XIA
+
+   An LC-Trie that can be updated while it is being looked up.
+
+   The routes are split by their first rootbits bits into slices, and every
+   slice has an ordinary LC-Trie of its own. A batch of updates is sorted and
+   merged in one pass into the sorted routes of every slice it touches, then
+   the LC-Trie of only those slices is rebuilt and each new LC-Trie is
+   published with an atomic store of the pointer of its slice. Lookups never
+   take a lock: they read the pointer of their slice once and search that
+   LC-Trie, old or new. Replaced LC-Tries are kept until lctrie_dyn_reclaim()
+   is called.
+*/
+#include <assert.h>
+#include <pthread.h>
+#include "lc_trie.h"
+
+/* The routes of one slice, sorted like compareentries() sorts entries */
+struct lctrie_slice
+{
+	struct entryrec *routes;
+	int nroutes;
+	int update;	//First entry of the bucket of the batch being applied
+	int nupdates;	//that holds an update of the slice, and their number
+};
+
+/* An update of a batch with its route masked to its length */
+struct lctrie_pending
+{
+	struct entryrec route;
+	int op;
+	int k;			//Index in the batch
+	uint32_t first, last;	//Slices that the route covers
+};
+
+/* An LC-Trie replaced by an update and not freed yet */
+struct lctrie_retired
+{
+	routtable_t table;
+	struct lctrie_retired *next;
+};
+
+struct lctrie_dyntable
+{
+	int rootbits;		//Number of bits that select a slice
+	struct lctrie_build_opts opts;
+	routtable_t *subtrie;	//LC-Trie of each slice, NULL if it is empty
+	struct lctrie_slice *slice;
+	struct lctrie_retired *retired;
+	pthread_mutex_t lock;	//Serialises the writers
+};
+
+/*
+ * Compare a route with the XID data of length len in the order of
+ * compareentries()
+ */
+static int routecompare(const struct entryrec *route, const xid *data, int len)
+{
+	int tmpresult = memcmp(route->data.w, data->w, XID_BYTES);
+
+	if (0 == tmpresult)
+		tmpresult = route->len - len;
+	return tmpresult;
+}
+
+/*
+ * Sort the updates of a batch like their routes and keep the updates of the
+ * same route in the order of the batch
+ */
+static int pendingcompare(const void *a, const void *b)
+{
+	const struct lctrie_pending *x = (const struct lctrie_pending *) a;
+	const struct lctrie_pending *y = (const struct lctrie_pending *) b;
+	int tmpresult = routecompare(&x->route, &y->route.data, y->route.len);
+
+	if (0 == tmpresult)
+		tmpresult = x->k - y->k;
+	return tmpresult;
+}
+
+/*
+ * Merge the updates p[bucket[0]], ..., p[bucket[m - 1]], sorted like the
+ * routes, into the routes of slice s. The updates of one route are applied in
+ * the order of the batch and changed[k] is set for every update k that
+ * changes the route. Return 1 if the routes of the slice changed and 0
+ * otherwise.
+ */
+static int slicemerge(struct lctrie_slice *s, const struct lctrie_pending *p,
+		const int *bucket, int m, char *changed)
+{
+	const struct lctrie_pending *u, *v;
+	struct entryrec *routes, route;
+	int i = 0, j = 0, n = 0, present, dirty = 0;
+
+	routes = malloc((s->nroutes + m) * sizeof(struct entryrec));
+	assert(routes);
+	while (j < m) {
+		v = &p[bucket[j]];
+		while (i < s->nroutes && routecompare(&s->routes[i],
+					&v->route.data, v->route.len) < 0)
+			routes[n++] = s->routes[i++];
+		present = i < s->nroutes && 0 == routecompare(&s->routes[i],
+				&v->route.data, v->route.len);
+		route = present ? s->routes[i++] : v->route;
+
+		for (; j < m; j++) {
+			u = &p[bucket[j]];
+			if (routecompare(&u->route, &v->route.data,
+						v->route.len))
+				break;
+			if (LCTRIE_DELETE == u->op) {
+				if (!present)
+					continue;
+				present = 0;
+			} else {
+				if (present &&
+					route.nexthop == u->route.nexthop)
+					continue;
+				present = 1;
+				route.nexthop = u->route.nexthop;
+			}
+			changed[u->k] = 1;
+			dirty = 1;
+		}
+		if (present)
+			routes[n++] = route;
+	}
+
+	if (!dirty) {
+		free(routes);
+		return 0;
+	}
+	while (i < s->nroutes)
+		routes[n++] = s->routes[i++];
+	free(s->routes);
+	s->routes = routes;
+	s->nroutes = n;
+	return 1;
+}
+
+/*
+ * Build the LC-Trie of slice s, or return NULL if the slice has no routes
+ */
+static routtable_t slicebuild(struct lctrie_slice *s,
+		const struct lctrie_build_opts *opts)
+{
+	routtable_t table;
+	entry_t *entry;
+	int i;
+
+	if (0 == s->nroutes)
+		return NULL;
+	entry = malloc(s->nroutes * sizeof(entry_t));
+	for (i = 0; i < s->nroutes; i++)
+		entry[i] = &s->routes[i];
+	table = buildrouttable(entry, s->nroutes, opts);
+	free(entry);
+	return table;
+}
+
+/*
+ * Apply the n updates in u to the table. The batch is sorted once and merged
+ * into the routes of every slice it changes, which then has its LC-Trie
+ * rebuilt and published once. Inserting a route that is already present
+ * replaces its next-hop, and deleting a route that is not present does
+ * nothing.
+ *
+ * Return the number of updates that changed the table.
+ */
+int lctrie_apply_updates(struct lctrie_dyntable *t,
+		const struct lctrie_update *u, int n)
+{
+	struct lctrie_pending *p = malloc(n * sizeof(struct lctrie_pending));
+	char *changed = calloc(n, sizeof(char));
+	struct lctrie_retired *r;
+	routtable_t old;
+	struct xid_words w;
+	uint32_t i;
+	int k, *bucket, nbucket = 0, count = 0;
+
+	for (k = 0; k < n; k++) {
+		assert(u[k].len >= 0 && u[k].len <= ADRSIZE);
+		// The bits past the length of a route are not part of it
+		xid_load(&w, &u[k].prefix);
+		xidw_mask(&w, u[k].len);
+		xid_store(&p[k].route.data, &w);
+		p[k].route.len = u[k].len;
+		p[k].route.nexthop = u[k].nexthop;
+		p[k].route.pre = NOPRE;
+		p[k].op = u[k].op;
+		p[k].k = k;
+
+		// A route shorter than rootbits covers several slices
+		p[k].first = xid_bits_u32(&p[k].route.data, 0, t->rootbits);
+		p[k].last = p[k].first;
+		if (u[k].len < t->rootbits)
+			p[k].last |= (1U << (t->rootbits - u[k].len)) - 1;
+		nbucket += p[k].last - p[k].first + 1;
+	}
+	qsort(p, n, sizeof(struct lctrie_pending), pendingcompare);
+
+	pthread_mutex_lock(&t->lock);
+	// Put the updates of every slice in its own part of bucket, in the
+	// order of its routes
+	for (k = 0; k < n; k++) {
+		for (i = p[k].first; i <= p[k].last; i++)
+			t->slice[i].nupdates++;
+	}
+	for (i = 0; i < (1U << t->rootbits); i++) {
+		t->slice[i].update = count;
+		count += t->slice[i].nupdates;
+		t->slice[i].nupdates = 0;
+	}
+	bucket = malloc(nbucket * sizeof(int));
+	for (k = 0; k < n; k++) {
+		for (i = p[k].first; i <= p[k].last; i++)
+			bucket[t->slice[i].update + t->slice[i].nupdates++] = k;
+	}
+
+	for (i = 0; i < (1U << t->rootbits); i++) {
+		if (0 == t->slice[i].nupdates)
+			continue;
+		k = slicemerge(&t->slice[i], p,
+				&bucket[t->slice[i].update],
+				t->slice[i].nupdates, changed);
+		t->slice[i].nupdates = 0;
+		if (!k)
+			continue;
+		old = t->subtrie[i];
+		__atomic_store_n(&t->subtrie[i],
+				slicebuild(&t->slice[i], &t->opts),
+				__ATOMIC_RELEASE);
+		if (NULL == old)
+			continue;
+		r = malloc(sizeof(struct lctrie_retired));
+		r->table = old;
+		r->next = t->retired;
+		t->retired = r;
+	}
+	pthread_mutex_unlock(&t->lock);
+
+	count = 0;
+	for (k = 0; k < n; k++)
+		count += changed[k];
+	free(bucket);
+	free(changed);
+	free(p);
+	return count;
+}
+
+/*
+ * Insert the route prefix/len with the given next-hop, or replace the
+ * next-hop of the route if it is already present
+ */
+int lctrie_insert(struct lctrie_dyntable *t, const xid *prefix, int len,
+		unsigned int nexthop)
+{
+	struct lctrie_update u;
+
+	u.op = LCTRIE_INSERT;
+	u.prefix = *prefix;
+	u.len = len;
+	u.nexthop = nexthop;
+	return lctrie_apply_updates(t, &u, 1);
+}
+
+/*
+ * Delete the route prefix/len
+ */
+int lctrie_delete(struct lctrie_dyntable *t, const xid *prefix, int len)
+{
+	struct lctrie_update u;
+
+	u.op = LCTRIE_DELETE;
+	u.prefix = *prefix;
+	u.len = len;
+	u.nexthop = 0;
+	return lctrie_apply_updates(t, &u, 1);
+}
+
+/*
+ * Create an updatable table from the routes in table, split into slices by
+ * their first rootbits bits
+ *
+ * opts: options for building the LC-Trie of every slice, NULL for the
+ * defaults in lc_trie.h
+ */
+struct lctrie_dyntable *lctrie_dyn_create(struct nextcreate *table,
+		unsigned long size, int rootbits,
+		const struct lctrie_build_opts *opts)
+{
+	struct lctrie_dyntable *t;
+	struct lctrie_update *u;
+	unsigned long i;
+
+	assert(rootbits >= 1 && rootbits <= MAXBRANCH);
+	t = calloc(1, sizeof(struct lctrie_dyntable));
+	t->rootbits = rootbits;
+	t->opts.fillfactor = LCTRIE_FILLFACTOR;
+	t->opts.rootbranch = LCTRIE_ROOTBRANCH;
+	t->opts.maxbranch = LCTRIE_MAXBRANCH;
+	t->opts.nthreads = LCTRIE_NTHREADS;
+	t->opts.dirbits = LCTRIE_DIRBITS;
+	if (opts)
+		t->opts = *opts;
+	t->subtrie = calloc(1 << rootbits, sizeof(routtable_t));
+	t->slice = calloc(1 << rootbits, sizeof(struct lctrie_slice));
+	assert(0 == pthread_mutex_init(&t->lock, NULL));
+
+	// The initial routes are one batch of inserts, which sorts them once
+	// and copies them into the empty slices in order
+	u = malloc(size * sizeof(struct lctrie_update));
+	for (i = 0; i < size; i++) {
+		u[i].op = LCTRIE_INSERT;
+		memcpy(u[i].prefix.w, table[i].prefix, HEXXID);
+		u[i].len = table[i].len;
+		u[i].nexthop = table[i].nexthop;
+	}
+	lctrie_apply_updates(t, u, size);
+	free(u);
+
+	return t;
+}
+
+/*
+ * Free the LC-Tries replaced by updates. The caller must make sure that no
+ * lookup that started before the last update is still running.
+ */
+int lctrie_dyn_reclaim(struct lctrie_dyntable *t)
+{
+	struct lctrie_retired *r, *next;
+
+	pthread_mutex_lock(&t->lock);
+	r = t->retired;
+	t->retired = NULL;
+	pthread_mutex_unlock(&t->lock);
+
+	for (; r != NULL; r = next) {
+		next = r->next;
+		lctrie_destroy_fib(r->table);
+		free(r);
+	}
+	return 0;
+}
+
+int lctrie_dyn_destroy(struct lctrie_dyntable *t)
+{
+	uint32_t i;
+
+	lctrie_dyn_reclaim(t);
+	for (i = 0; i < (1U << t->rootbits); i++) {
+		if (t->subtrie[i])
+			lctrie_destroy_fib(t->subtrie[i]);
+		free(t->slice[i].routes);
+	}
+	free(t->subtrie);
+	free(t->slice);
+	pthread_mutex_destroy(&t->lock);
+	free(t);
+
+	return 0;
+}
+
+unsigned int lctrie_dyn_lookup(const xid *id, struct lctrie_dyntable *t)
+{
+	routtable_t sub;
+
+	sub = __atomic_load_n(&t->subtrie[xid_bits_u32(id, 0, t->rootbits)],
+			__ATOMIC_ACQUIRE);
+	return NULL == sub ? 0 : find(id, sub);
+}
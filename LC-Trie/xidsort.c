@@ -7,8 +7,12 @@
    as defined in build_table.c
 */
 #include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
 #include "lc_trie.h"
 
+#define PARALLELSORTMIN (1 << 14) /* fewest elements sorted by several threads */
+
 /* Sort an array of XIDs pointed by "base" of size "narray" */
 void xidsort(list *base, size_t narray, size_t size, int (*compare)(const void *, const void *))
 {
@@ -20,3 +24,105 @@ void xidentrysort(entry_t entry[], size_t narray, size_t size, int (*compare)(co
 {
 	qsort(&entry[0], narray, size, compare);
 }
+
+/* A range of elements sorted or merged by a thread of xidentrysort_parallel() */
+struct sortrun {
+	pthread_t thread;
+	char *src;	/* the elements, sorted in [lo, mid) and [mid, hi) */
+	char *dst;	/* where the merged range is written */
+	size_t lo, mid, hi;
+	size_t size;
+	int (*compare)(const void *, const void *);
+};
+
+static void *sortrun(void *arg)
+{
+	struct sortrun *r = arg;
+
+	qsort(r->src + r->lo * r->size, r->hi - r->lo, r->size, r->compare);
+	return NULL;
+}
+
+static void *mergerun(void *arg)
+{
+	struct sortrun *r = arg;
+	size_t i = r->lo, j = r->mid, k = r->lo;
+
+	while (i < r->mid && j < r->hi) {
+		if (r->compare(r->src + i * r->size, r->src + j * r->size) <= 0)
+			memcpy(r->dst + k++ * r->size, r->src + i++ * r->size, r->size);
+		else
+			memcpy(r->dst + k++ * r->size, r->src + j++ * r->size, r->size);
+	}
+	memcpy(r->dst + k * r->size, r->src + i * r->size, (r->mid - i) * r->size);
+	k += r->mid - i;
+	memcpy(r->dst + k * r->size, r->src + j * r->size, (r->hi - j) * r->size);
+	return NULL;
+}
+
+/*
+ * Sort an array of entry structures pointed by "entry" of size "narray" with
+ * nthreads threads. Each thread sorts one slice of the array with qsort() and
+ * the sorted slices are then merged pairwise, one thread per pair, until a
+ * single run is left.
+ */
+void xidentrysort_parallel(entry_t entry[], size_t narray, size_t size, int (*compare)(const void *, const void *), int nthreads)
+{
+	struct sortrun *runs;
+	size_t *bounds;
+	char *src = (char *) entry, *dst, *tmp;
+	int i, nruns;
+
+	if (nthreads <= 1 || narray < PARALLELSORTMIN) {
+		qsort(&entry[0], narray, size, compare);
+		return;
+	}
+
+	runs = malloc(nthreads * sizeof(struct sortrun));
+	bounds = malloc((nthreads + 1) * sizeof(size_t));
+	dst = malloc(narray * size);
+	for (i = 0; i <= nthreads; i++)
+		bounds[i] = narray * i / nthreads;
+
+	for (i = 0; i < nthreads; i++) {
+		runs[i].src = src;
+		runs[i].lo = bounds[i];
+		runs[i].hi = bounds[i + 1];
+		runs[i].size = size;
+		runs[i].compare = compare;
+		assert(0 == pthread_create(&runs[i].thread, NULL, sortrun, &runs[i]));
+	}
+	for (i = 0; i < nthreads; i++)
+		assert(0 == pthread_join(runs[i].thread, NULL));
+
+	for (nruns = nthreads; nruns > 1; nruns = (nruns + 1) / 2) {
+		for (i = 0; i + 1 < nruns; i += 2) {
+			runs[i].src = src;
+			runs[i].dst = dst;
+			runs[i].lo = bounds[i];
+			runs[i].mid = bounds[i + 1];
+			runs[i].hi = bounds[i + 2];
+			assert(0 == pthread_create(&runs[i].thread, NULL, mergerun, &runs[i]));
+		}
+		// An odd run out is only copied
+		if (nruns & 1)
+			memcpy(dst + bounds[nruns - 1] * size, src + bounds[nruns - 1] * size,
+					(bounds[nruns] - bounds[nruns - 1]) * size);
+		for (i = 0; i + 1 < nruns; i += 2)
+			assert(0 == pthread_join(runs[i].thread, NULL));
+		for (i = 0; 2 * i < nruns; i++)
+			bounds[i] = bounds[2 * i];
+		bounds[i] = narray;
+		tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	if (src != (char *) entry) {
+		memcpy(entry, src, narray * size);
+		dst = src;
+	}
+	free(dst);
+	free(bounds);
+	free(runs);
+}
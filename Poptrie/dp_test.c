@@ -38,7 +38,7 @@ static int _create_data_dp(int size, XID *tmp_xid)
 	for (i = 0; i < (1 << size); i++) {
 		_msb_int_to_xid(i, tmp, size);
 		check_xid = shift_right(*tmp, UINT32XID);
-		assert(i == XIDtounsigned(&check_xid));
+		assert(i == xidtounsigned(&check_xid));
 		tmp++;
 	}
 //	printf("Verified Data creation for upto 2^%d\n", size);
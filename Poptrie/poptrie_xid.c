@@ -13,7 +13,7 @@
 #define EXT_NH(n)	((n)->ext ? (n)->ext->nexthop : 0)
 /*#define INDEX(a, s, n) \
 	((u64)(a) >> (64 - ((s) + (n)))) & ((1 << (n)) - 1)*/
-#define INDEX(a) XIDtounsigned(&a)
+#define INDEX(a) xidtounsigned(&a)
 #define VEC_INIT(v)	((v) = 0)
 #define VEC_BT(v, i)	((v) & (u64)1 << (i))
 #define BITINDEX(v)	((v) & ((1 << 6) - 1))
@@ -325,11 +325,9 @@ void * poptrie_lookup(struct poptrie *poptrie, XID addr)
 	int base;
 	int idx;
 	int pos;
-	XID tmp;
 
 	/* Top tier */
-	tmp = shift_right(addr, 160 - POPTRIE_S);
-	idx = INDEX(tmp);
+	idx = xid_bits_u32(&addr, 0, POPTRIE_S);
 	pos = POPTRIE_S;
 	base = poptrie->root;
 	check_num++;
@@ -339,8 +337,7 @@ void * poptrie_lookup(struct poptrie *poptrie, XID addr)
 		return poptrie->fib.entries[poptrie->dir[idx] & (((u32)1 << 31) - 1)];
 	} else {
 		base = poptrie->dir[idx];
-		tmp = extractXID(pos, 6, addr);
-		idx = INDEX(tmp);
+		idx = xid_bits_u32(&addr, pos, 6);
 		pos += 6;
 	}
 
@@ -353,8 +350,7 @@ void * poptrie_lookup(struct poptrie *poptrie, XID addr)
 			/* Next internal node index */
 			base = base + (idx - 1);
 			/* Next node vector */
-			tmp = extractXID(pos, 6, addr);
-			idx = INDEX(tmp);
+			idx = xid_bits_u32(&addr, pos, 6);
 			pos += 6;
 		} else {
 			/* Leaf */
@@ -854,7 +850,7 @@ static int _descend_and_update(struct poptrie *poptrie, struct radix_node *tnode
 		return _update_part(poptrie, tnode, inode, stack, root, 0);
 	} else {
 		/* This is not the top of the marked part, then traverse to a child */
-		tmp = extractXID(depth, width, prefix);
+		tmp = extract(depth, width, prefix);
 		idx = INDEX(tmp);
 
 		if (inode < 0) {
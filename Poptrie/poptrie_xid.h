@@ -7,12 +7,13 @@
 #define _POPTRIE_XID_H
 
 #include <stdint.h>
+#include "../XID-Kernel/xid_kernel.h"
 
 typedef uint8_t u8;
 typedef uint16_t u16;
 typedef uint32_t u32;
 typedef uint64_t u64;
-typedef struct XID {unsigned char w[20];} XID;
+typedef xid XID;
 
 
 #define POPTRIE_S	18
@@ -100,10 +101,4 @@ int poptrie_route_add(struct poptrie *, XID, int, void *);
 void * poptrie_lookup(struct poptrie *, XID);
 void * poptrie_rib_lookup(struct poptrie *, XID);
 
-/* in xid_operations.c*/
-XID extractXID(int pos, int length, XID data);
-uint32_t XIDtounsigned(XID *bitpat);
-XID shift_left(XID id, int shift);
-XID shift_right(XID id, int shift);
-
 #endif
@@ -19,6 +19,11 @@ int compareentries(const void *id1, const void *id2)
 
 	tmpresult = comparexid(&tmp_id1, &tmp_id2);
 
+	// Entries with the same bits are ordered by length so that the shorter
+	// one is always found to be a prefix of the longer one
+	if (0 == tmpresult)
+		tmpresult = (*tmp_entry1)->len - (*tmp_entry2)->len;
+
 	if (tmpresult < 0)
 		return -1;
 	else if (tmpresult > 0)
@@ -40,33 +45,13 @@ static int count_pat_nodes(struct node_patric *n)
 /*
  * Compute the number of bits to be skipped for a range of XID addresses.
  *
- * base: base vector
- * prefix: prefix common to the XIDs starting at position first and having
- * total n such XIDs
+ * Since the base vector is sorted, the bits common to all the XIDs starting at
+ * position first and having total n such XIDs are the longest common prefix
+ * of the first and the last of them.
  */
-static int skipcompute(struct baserec *base[], int prefix, int first, int n)
+static int skipcompute(struct baserec *base[], int first, int n)
 {
-	int i, match;
-	xid low, high, *plow, *phigh;
-
-	// Compute the skip value for that node
-	low = removexid(prefix, base[first]->str);
-	high = removexid(prefix, base[first + n - 1]->str);
-	i = prefix;
-	plow = malloc(sizeof(xid));
-	phigh = malloc(sizeof(xid));
-	*plow = extract(i, 1, low);
-	*phigh = extract(i, 1, high);
-	match = comparexid(&plow, &phigh);
-	while (0 == match) {
-		i++;
-		*plow = extract(i, 1, low);
-		*phigh = extract(i, 1, high);
-		match = comparexid(&plow, &phigh);
-	}
-	free(plow);
-	free(phigh);
-	return i;
+	return xid_lcp(&base[first]->str, &base[first + n - 1]->str);
 }
 
 /*
@@ -76,20 +61,26 @@ static int skipcompute(struct baserec *base[], int prefix, int first, int n)
  * prefix: number of bits that are common to the callee node
  * first: starting address of the base for callee node
  * n: number of addresses of the base for the callee node
+ *
+ * The XIDs whose bit at position prefix is 0 belong to the left subtrie and
+ * precede the others in the sorted base vector, so the boundary is found by a
+ * binary search.
  */
 static int subtriecompute(struct baserec *base[], int prefix, int first, int n)
 {
-	xid tmp;
-	int nleft = 0;
-	unsigned char left = (unsigned char) 0;
+	int low = first;
+	int high = first + n;
+	int mid;
 
 	// Find the number of prefixes in base that belong to left subtrie
-	tmp = extract(prefix, 1, base[first]->str);
-	while (left == tmp.w[HEXXID - 1]) {
-		nleft++;
-		tmp = extract(prefix, 1, base[first + nleft]->str);
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (xid_bits_u32(&base[mid]->str, prefix, 1))
+			high = mid;
+		else
+			low = mid + 1;
 	}
-	return nleft;
+	return low - first;
 }
 
 /*
@@ -101,33 +92,33 @@ static int subtriecompute(struct baserec *base[], int prefix, int first, int n)
  * "first" to "first + n - 1"
  * first: first index of base vector
  * n: number of prefixes in base vector starting at index first 
+ * node: the node arena, the node of the range is node[adr]
+ * nnodes: number of nodes of the arena in use
  */
-static struct node_patric *buildpatricia(struct baserec *base[], int prefix,
-		int first, int n)
+static void buildpatricia(struct baserec *base[], int prefix, int first, int n,
+		struct node_patric *node, uint32_t adr, int *nnodes)
 {
-	int i, newprefix, nleft;
-	struct node_patric *node;
+	int newprefix, nleft;
+	uint32_t child;
 
 	// Reached the leaf node
 	if (1 == n) {
-		node = malloc(sizeof(struct node_patric));
-		node->left = NULL;
-		node->right = NULL;
-		node->skip = base[first]->len - prefix;
-		node->base = first;
-		return node;
+		node[adr].skip = base[first]->len - prefix;
+		node[adr].link = first | RADIXLEAF;
+		return;
 	}
 
 	//Find the number of bits to be skipped for the new node being constructed
 	//and range of XIDs for each of its child
-	newprefix = skipcompute(base, prefix, first, n);
-	node = malloc(sizeof(struct node_patric));
-	node->skip = newprefix - prefix;
-	node->base = NOBASE;
+	newprefix = skipcompute(base, first, n);
+	child = *nnodes;
+	*nnodes += 2;
+	node[adr].skip = newprefix - prefix;
+	node[adr].link = child;
 	nleft = subtriecompute(base, newprefix, first, n);
-	node->left = buildpatricia(base, newprefix + 1, first, nleft);
-	node->right = buildpatricia(base, newprefix + 1, first + nleft, n - nleft);
-	return node;
+	buildpatricia(base, newprefix + 1, first, nleft, node, child, nnodes);
+	buildpatricia(base, newprefix + 1, first + nleft, n - nleft, node,
+			child + 1, nnodes);
 }
 
 /*
@@ -137,22 +128,14 @@ static struct node_patric *buildpatricia(struct baserec *base[], int prefix,
  */
 int isprefix(struct entryrec *s, struct entryrec *t)
 {
-	int tmp = 0;
-	int equal = -1;
-	int length; //Represents the length of the prefix in the routing entry "s"
-	xid s_data, t_data;
-	xid *ps_data = &s_data;
-	xid *pt_data = &t_data;
+	int length;	//Represents the length of the prefix in the routing entry "s"
 
 	if (NULL == s)
-		return tmp;
+		return 0;
 
 	length = s->len;
-	s_data = extract(0, length, s->data);
-	t_data = extract(0, length, t->data);
-	equal = comparexid(&ps_data, &pt_data);
-	tmp = ((0 == length) || ((length <= t->len) && (0 == equal)));
-	return tmp;
+	return ((0 == length) || ((length <= t->len) &&
+			(xid_lcp(&s->data, &t->data) >= length)));
 }
 
 int compare(const void * a, const void * b)
@@ -200,84 +183,108 @@ static unsigned int *buildnexthoptable(struct entryrec *entry[], int nentries, i
 }
 
 /*
- * Check if one xid is prefix of another xid?
+ * Split the sorted entries into the base vector, the entries that are not a
+ * prefix of another entry, and the prefix vector with the next-hops of the
+ * prefixes of every base vector entry.
+ *
+ * Return the number of base vector entries, which are in the order of the
+ * entries, and store the vectors in base and pre and the size of the prefix
+ * vector in npre.
  */
-static int check_prefix(xid orig, xid pref, int len)
+int buildvectors(struct entryrec *entry[], int nentries,
+		struct baserec **base, unsigned int **pre, int *npre)
 {
-	int i, j, neq;
-	xid *tmp = alloca(sizeof(xid));
-	xid *bitmask = alloca(sizeof(xid));
-	memset(bitmask, 0, HEXXID);
-
-	for (i = 0; i <= len / 8; i++)
-		tmp->w[i] = orig.w[i] ^ pref.w[i];
-	tmp->w[i - 1] = (tmp->w[i - 1] >> (8 - len % 8)) << (8 - len % 8);
-	for (j = i; j < 20; j++)
-		tmp->w[j] = 0;
-	neq = comparexid(&bitmask, &tmp);
-	if (!neq)
-		return 1;
-	else
-		return 0;
-}
+	struct baserec **b = NULL;
+	struct baserec *btemp = NULL;
+	struct baserec *brecs = NULL;
+	struct tmp_prerec **p = NULL;
+	struct tmp_prerec *ptemp = NULL;
+	struct tmp_prerec *precs = NULL;
 
-/*
- * Checks for existence in prefix tree and add if not present
- */
-static int in_prefix_tree(struct node_patric *root, struct tmp_prerec *pre,
-			int id, struct baserec **b, struct tmp_prerec **p)
-{
-	struct node_patric *cur_node = root;
-	xid *bitmask = alloca(sizeof(xid));
-	int pos = 0;
-	int pidx, bidx;
-	int tmp;
-
-	pos = cur_node->skip;
-	while (NOBASE == cur_node->base) {
-		*bitmask = extract(pos, 1, pre->str);
-		pos++;
-		if (bitmask->w[HEXXID - 1])
-			cur_node = cur_node->right;
-		else
-			cur_node = cur_node->left;
-		pos += cur_node->skip;
-	}
+	/* Auxiliary variables */
+	int i, j, nprefs = 0, nbases = 0, depth;
+	int *run;
+	uint64_t (*premap)[XID_LENMAP_WORDS];
 
-	bidx = cur_node->base;
-	pidx = b[bidx]->pre;
-	tmp = pidx;
-	if ((NOPRE == pidx) && (1 == check_prefix(b[bidx]->str, pre->str, pre->len))){
-		b[bidx]->pre = id;
-		return 1;
-	}
-	while (1 == check_prefix(p[tmp]->str, pre->str, pre->len)) {
-		pidx = p[pidx]->pre;
-		if (NOPRE == pidx){
-			p[tmp]->pre = id;
-			return 1;
+	b = (struct baserec **) malloc(nentries * sizeof(struct baserec *));
+	p = (struct tmp_prerec **) malloc(nentries * sizeof(struct tmp_prerec *));
+	brecs = malloc(nentries * sizeof(struct baserec));
+	precs = malloc(nentries * sizeof(struct tmp_prerec));
+
+	//Initialize pre-pointers
+	for (i = 0; i < nentries; i++)
+		entry[i]->pre = NOPRE;
+
+	//Go through the entries and put the prefixes in p
+	//and the rest of the strings in b
+	for (i = 0; i < nentries; i++) {
+		if (i < nentries - 1 && isprefix(entry[i], entry[i + 1])) {
+			ptemp = &precs[nprefs];
+			memcpy(&(ptemp->str), &(entry[i]->data), HEXXID);
+			ptemp->len = entry[i]->len;
+			ptemp->pre = entry[i]->pre;
+			//Update 'pre' for all entries that have this prefix
+			for (j = i + 1; j < nentries && isprefix(entry[i], entry[j]); j++)
+				entry[j]->pre = nprefs;
+			ptemp->nexthop = entry[i]->nexthop;
+			p[nprefs] = ptemp;
+			nprefs++;
 		} else {
-			tmp = pidx;
+			btemp = &brecs[nbases];
+			btemp->len = entry[i]->len;
+			btemp->str = entry[i]->data;
+			btemp->pre = entry[i]->pre;
+			btemp->nexthop = entry[i]->nexthop;
+			b[nbases] = btemp;
+			nbases++;
 		}
 	}
 
-	return 0;
-}
+	//The prefixes of prefix i are the lengths in premap[i] and its
+	//next-hops start at entry run[i] of the prefix vector. The prefix
+	//of a prefix always comes before it in p.
+	run = malloc(nprefs * sizeof(int));
+	premap = calloc(nprefs, sizeof(*premap));
+	*npre = 0;
+	for (i = 0; i < nprefs; i++) {
+		if (p[i]->pre != NOPRE)
+			memcpy(premap[i], premap[p[i]->pre], sizeof(*premap));
+		xid_lenmap_set(premap[i], p[i]->len);
+		run[i] = *npre;
+		*npre += xid_lenmap_rank(premap[i], ADRSIZE);
+	}
 
-/*
- * Build the prefix tree i.e tree where prefixes in the table are to be searched
- */
-static int build_prefix_tree(struct tmp_prerec **p, struct baserec **b,
-				int nprefs, struct node_patric *root)
-{
-	// Build the prefix tree
-	int i;
+	//At this point we now how much memory to allocate
+	*base = calloc(nbases, sizeof(struct baserec));
+	*pre = malloc(*npre * sizeof(unsigned int));
+
+	for (i = 0; i < nprefs; i++) {
+		depth = xid_lenmap_rank(premap[i], ADRSIZE);
+		if (p[i]->pre != NOPRE)
+			memcpy(&(*pre)[run[i]], &(*pre)[run[p[i]->pre]],
+					(depth - 1) * sizeof(unsigned int));
+		(*pre)[run[i] + depth - 1] = p[i]->nexthop;
+	}
+	free(precs);
+	free(p);
 
-	for (i = nprefs - 1; i > -1; i--) {
-		assert(0 != in_prefix_tree(root, p[i], i, b, p));
+	for (i = 0; i < nbases; i++) {
+		memcpy(&(*base)[i].str, &(b[i]->str), HEXXID);
+		(*base)[i].len = b[i]->len;
+		(*base)[i].pre = NOPRE;
+		(*base)[i].nexthop = b[i]->nexthop;
+		if (b[i]->pre != NOPRE) {
+			(*base)[i].pre = run[b[i]->pre];
+			memcpy((*base)[i].premap, premap[b[i]->pre],
+					sizeof(*premap));
+		}
 	}
+	free(brecs);
+	free(b);
+	free(premap);
+	free(run);
 
-	return 0;
+	return nbases;
 }
 
 /*
@@ -289,17 +296,16 @@ struct routtablerec *buildrouttable(struct entryrec *entry[], int nentries)
 	int nnexthops;
 	
 	struct baserec **b = NULL;
-	struct baserec *btemp = NULL;
-	struct tmp_prerec **p = NULL;
-	struct tmp_prerec *ptemp = NULL;
+	struct node_patric *node = NULL;
+	int nnodes;
 
 	struct baserec *base = NULL;
-	struct prerec *pre = NULL;
+	unsigned int *pre = NULL;
 	
 	struct routtablerec *table = NULL;  // The complete data structure
 	
 	/* Auxiliary variables */
-	int i, j, nprefs = 0, nbases = 0, *tmp_val = NULL;
+	int i, nbases, npre;
 
 	nexthop = buildnexthoptable(entry, nentries, &nnexthops);
 
@@ -312,78 +318,25 @@ struct routtablerec *buildrouttable(struct entryrec *entry[], int nentries)
 	}
 	assert(size == nentries);*/
 
-	// The number of internal nodes in the tree can't be larger
-	// than the number of entries.
-	b = (struct baserec **) malloc(nentries * sizeof(struct baserec *));
-	p = (struct tmp_prerec **) malloc(nentries * sizeof(struct tmp_prerec *));
-
-	//Initialize pre-pointers
-	for (i = 0; i < nentries; i++)
-		entry[i]->pre = NOPRE;
+	nbases = buildvectors(entry, nentries, &base, &pre, &npre);
+	b = (struct baserec **) malloc(nbases * sizeof(struct baserec *));
+	for (i = 0; i < nbases; i++)
+		b[i] = &base[i];
 
-	int k;
-	//Go through the entries and put the prefixes in p
-	//and the rest of the strings in b
-	for (i = 0; i < nentries; i++) {
-		if (i < nentries - 1 && isprefix(entry[i], entry[i + 1])) {
-			ptemp = malloc(sizeof(struct tmp_prerec));
-			memcpy(&(ptemp->str), &(entry[i]->data), HEXXID);
-			ptemp->len = entry[i]->len;
-			ptemp->pre = entry[i]->pre;
-			// Buggy code, needed to debug
-			//Update 'pre' for all entries that have this prefix
-/*			for (j = i + 1; j < nentries && isprefix(entry[i], entry[j]); j++) {
-					entry[j]->pre = nprefs;
-			}*/
-			tmp_val = bsearch(&entry[i]->nexthop, nexthop,
-				nnexthops, sizeof(unsigned int), compare);
-			ptemp->nexthop = *tmp_val;
-			p[nprefs] = ptemp;
-			nprefs++;
-		} else {
-			btemp = malloc(sizeof(struct baserec));
-			btemp->len = entry[i]->len;
-			btemp->str = entry[i]->data;
-			btemp->pre = entry[i]->pre;
-			tmp_val = bsearch(&entry[i]->nexthop, nexthop,
-				nnexthops, sizeof(unsigned int), compare);
-			btemp->nexthop = *tmp_val;
-			b[nbases] = btemp;
-			nbases++;
-		}
-	}
-	struct node_patric *root = NULL;
-	root = buildpatricia(b, 0, 0, nbases);
-	// This can be removed after the buggy code in above prefix vector is removed
-	assert(0 == build_prefix_tree(p, b, nprefs, root));
-
-	//At this point we now how much memory to allocate
-	base = malloc(nbases * sizeof(struct baserec));
-	pre = malloc(nprefs * sizeof(struct prerec));
-
-	for (i = 0; i < nbases; i++) {
-		memcpy(&base[i].str, &(b[i]->str), HEXXID);
-		base[i].len = b[i]->len;
-		base[i].pre = b[i]->pre;
-		base[i].nexthop = b[i]->nexthop;
-		free(b[i]);
-	}
+	//A Patricia trie with nbases leaves has nbases - 1 internal nodes
+	assert(0 == posix_memalign((void **) &node, RADIXALIGN,
+				(2 * nbases - 1) * sizeof(struct node_patric)));
+	nnodes = 1;
+	buildpatricia(b, 0, 0, nbases, node, 0, &nnodes);
 	free(b);
 
-	for (i = 0; i < nprefs; i++) {
-		pre[i].len = p[i]->len;
-		pre[i].pre = p[i]->pre;
-		pre[i].nexthop = p[i]->nexthop;
-		free(p[i]);
-	}
-	free(p);
-
 	table = (struct routtablerec *) malloc(sizeof(struct routtablerec));
-	table->root = root;
+	table->node = node;
+	table->nnodes = nnodes;
 	table->base = base;
 	table->basesize = nbases;
 	table->pre = pre;
-	table->presize = nprefs;
+	table->presize = npre;
 	table->nexthop = nexthop;
 	table->nexthopsize = nnexthops;
 	return table;
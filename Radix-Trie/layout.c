@@ -0,0 +1,159 @@
+/*
+ * Garnaik Sumeet, Michel Machado 2015
+ * LPM Algorithms for Linux-XIA
+ *
+ * Relayout of the node arena of a built Radix trie.
+ *
+ * The nodes are moved in units that are never split: the root alone and the
+ * pairs of siblings, since a link only names the left child of a pair. The
+ * units are placed in breadth-first order, depth-first order or in a van Emde
+ * Boas layout, which stores a top subtree of half the height followed by each
+ * of the subtrees hanging from it, recursively, so that the units read by a
+ * lookup are close together at every scale.
+ */
+#include <assert.h>
+#include "lpm_radix.h"
+
+struct layout
+{
+	const struct node_patric *node;	//The arena being laid out
+	uint32_t *unit;			//Units in their new order
+	int nunits;
+};
+
+/* Return the number of nodes of the unit that starts at node u */
+static int unitsize(uint32_t u)
+{
+	return 0 == u ? 1 : 2;
+}
+
+/* Return the number of levels of units of the subtrie of unit u */
+static int unitheight(const struct node_patric *node, uint32_t u)
+{
+	int i, h, height = 0;
+
+	for (i = 0; i < unitsize(u); i++) {
+		if (ISLEAF(&node[u + i]))
+			continue;
+		h = unitheight(node, node[u + i].link);
+		if (h > height)
+			height = h;
+	}
+	return height + 1;
+}
+
+static void layoutdfs(struct layout *l, uint32_t u)
+{
+	int i;
+
+	l->unit[l->nunits++] = u;
+	for (i = 0; i < unitsize(u); i++) {
+		if (!ISLEAF(&l->node[u + i]))
+			layoutdfs(l, l->node[u + i].link);
+	}
+}
+
+static void layoutbfs(struct layout *l)
+{
+	int head, i;
+	uint32_t u;
+
+	l->unit[l->nunits++] = 0;
+	for (head = 0; head < l->nunits; head++) {
+		u = l->unit[head];
+		for (i = 0; i < unitsize(u); i++) {
+			if (!ISLEAF(&l->node[u + i]))
+				l->unit[l->nunits++] = l->node[u + i].link;
+		}
+	}
+}
+
+static void layoutveb(struct layout *l, uint32_t u, int height);
+
+/*
+ * Lay out the subtries hanging depth levels below unit u, each one with the
+ * given height
+ */
+static void layoutbottom(struct layout *l, uint32_t u, int depth, int height)
+{
+	int i;
+
+	if (0 == depth) {
+		layoutveb(l, u, height);
+		return;
+	}
+	for (i = 0; i < unitsize(u); i++) {
+		if (!ISLEAF(&l->node[u + i]))
+			layoutbottom(l, l->node[u + i].link, depth - 1,
+					height);
+	}
+}
+
+/*
+ * Lay out the top height levels of the subtrie of unit u
+ */
+static void layoutveb(struct layout *l, uint32_t u, int height)
+{
+	int top;
+
+	if (1 == height) {
+		l->unit[l->nunits++] = u;
+		return;
+	}
+	top = height / 2;
+	layoutveb(l, u, top);
+	layoutbottom(l, u, top, height - top);
+}
+
+/*
+ * Move the nodes of the trie of t into the given layout, RADIX_LAYOUT_DFS,
+ * RADIX_LAYOUT_BFS or RADIX_LAYOUT_VEB. Lookups are not affected other than
+ * by the order of the nodes in memory.
+ */
+int radix_layout(struct routtablerec *t, int layout)
+{
+	struct node_patric *node;
+	uint32_t *newadr;
+	struct layout l;
+	int i, j, n;
+
+	l.node = t->node;
+	l.unit = malloc(t->nnodes * sizeof(uint32_t));
+	l.nunits = 0;
+	switch (layout) {
+	case RADIX_LAYOUT_DFS:
+		layoutdfs(&l, 0);
+		break;
+	case RADIX_LAYOUT_BFS:
+		layoutbfs(&l);
+		break;
+	case RADIX_LAYOUT_VEB:
+		layoutveb(&l, 0, unitheight(t->node, 0));
+		break;
+	default:
+		free(l.unit);
+		return -1;
+	}
+
+	// Copy the units in their new order and then move the links along
+	assert(0 == posix_memalign((void **) &node, RADIXALIGN,
+				t->nnodes * sizeof(struct node_patric)));
+	newadr = malloc(t->nnodes * sizeof(uint32_t));
+	n = 0;
+	for (i = 0; i < l.nunits; i++) {
+		newadr[l.unit[i]] = n;
+		for (j = 0; j < unitsize(l.unit[i]); j++)
+			node[n++] = t->node[l.unit[i] + j];
+	}
+	assert(n == t->nnodes);
+	for (i = 0; i < n; i++) {
+		if (!ISLEAF(&node[i]))
+			node[i].link = newadr[node[i].link];
+	}
+
+	free(newadr);
+	free(l.unit);
+	free(t->node);
+	t->node = node;
+	return 0;
+}
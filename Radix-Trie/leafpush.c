@@ -0,0 +1,176 @@
+/*
+ * Garnaik Sumeet, Michel Machado 2015
+ * LPM Algorithms for Linux-XIA
+ *
+ * A leaf-pushed variant of the Radix trie.
+ *
+ * Every node of the Patricia trie can skip bits without checking them, so
+ * find() has to compare the whole XID with the base vector entry it ends at
+ * and then select one of its prefixes. Here a node compares the bits it skips,
+ * at most LPSKIP of them, and a path is split wherever an entry ends, so an
+ * entry ends exactly after the bits of one node. The next-hop of the longest
+ * entry that ends on the way to a node, or at the node, is pushed into it. A
+ * lookup keeps the last node whose bits matched and reads its next-hop once
+ * it stops, without reading any entry.
+ */
+#include <assert.h>
+#include "xidsort.h"
+#include "radix.h"
+
+struct lpbuild
+{
+	struct entryrec **entry;	//The entries, sorted
+	struct lpnode *node;
+	unsigned int *nexthop;
+	int nnodes;
+	int maxnodes;
+};
+
+/* Allocate n consecutive nodes and return the index of the first one */
+static uint32_t allocnodes(struct lpbuild *m, int n)
+{
+	uint32_t first = m->nnodes;
+
+	if (m->nnodes + n > m->maxnodes) {
+		m->maxnodes = 2 * m->maxnodes + n;
+		m->node = realloc(m->node, m->maxnodes * sizeof(struct lpnode));
+		m->nexthop = realloc(m->nexthop,
+				m->maxnodes * sizeof(unsigned int));
+		assert(m->node && m->nexthop);
+	}
+	m->nnodes += n;
+	assert(m->nnodes <= LPMAXNODES);
+	return first;
+}
+
+/*
+ * Return the number of entries first to last - 1 whose bit pos is 0, which
+ * precede the others
+ */
+static int leftcompute(struct entryrec *entry[], int pos, int first, int last)
+{
+	int low = first, high = last, mid;
+
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (xid_bits_u32(&entry[mid]->data, pos, 1))
+			high = mid;
+		else
+			low = mid + 1;
+	}
+	return low - first;
+}
+
+/*
+ * Build node adr for the entries first to last - 1, which share their first
+ * depth bits and are at least depth bits long. nexthop is the next-hop pushed
+ * from the entries that end before.
+ */
+static void buildlpnode(struct lpbuild *m, int first, int last, int depth,
+		unsigned int nexthop, uint32_t adr)
+{
+	struct entryrec **entry = m->entry;
+	int end, lcp, nleft;
+	uint32_t child;
+
+	// A child that no entry goes through matches nothing of its own
+	if (first == last) {
+		m->node[adr].bits = 0;
+		m->node[adr].link = 0;
+		m->nexthop[adr] = nexthop;
+		return;
+	}
+
+	// The node stops where the entries part, where the first one ends,
+	// since an entry shorter than that is a prefix of all the others, or
+	// after LPSKIP bits
+	lcp = xid_lcp(&entry[first]->data, &entry[last - 1]->data);
+	end = lcp;
+	if (entry[first]->len < end)
+		end = entry[first]->len;
+	if (depth + LPSKIP < end)
+		end = depth + LPSKIP;
+	// A node at the end of the XID has no bits, nor a place to read them
+	m->node[adr].bits = end > depth ? xid_bits_u32(&entry[first]->data,
+			depth, end - depth) : 0;
+	m->node[adr].link = end - depth;
+	while (first < last && entry[first]->len == end)
+		nexthop = entry[first++]->nexthop;
+	m->nexthop[adr] = nexthop;
+	if (first == last)
+		return;
+
+	// The entries go on together when the node stopped before they part
+	if (end < lcp) {
+		child = allocnodes(m, 1);
+		m->node[adr].link |= LPCHAIN | child << LPLINKSHIFT;
+		buildlpnode(m, first, last, end, nexthop, child);
+		return;
+	}
+	child = allocnodes(m, 2);
+	m->node[adr].link |= child << LPLINKSHIFT;
+	nleft = leftcompute(entry, end, first, last);
+	buildlpnode(m, first, first + nleft, end + 1, nexthop, child);
+	buildlpnode(m, first + nleft, last, end + 1, nexthop, child + 1);
+}
+
+/*
+ * Build the leaf-pushed trie of the entries
+ *
+ * entry: array of entryrec pointers
+ * nentries: number of total entries
+ */
+struct radix_lptable *buildlptable(struct entryrec *entry[], int nentries)
+{
+	struct radix_lptable *table;
+	struct lpbuild m;
+
+	xidentrysort(entry, nentries, sizeof(struct entryrec *), compareentries);
+	m.entry = entry;
+	m.node = NULL;
+	m.nexthop = NULL;
+	m.nnodes = 0;
+	m.maxnodes = 0;
+	allocnodes(&m, 1);
+	buildlpnode(&m, 0, nentries, 0, 0, 0);
+
+	table = malloc(sizeof(struct radix_lptable));
+	assert(0 == posix_memalign((void **) &table->node, RADIXALIGN,
+				m.nnodes * sizeof(struct lpnode)));
+	memcpy(table->node, m.node, m.nnodes * sizeof(struct lpnode));
+	table->nexthop = realloc(m.nexthop, m.nnodes * sizeof(unsigned int));
+	table->nnodes = m.nnodes;
+	free(m.node);
+	return table;
+}
+
+/*
+ * Return a nexthop or 0 if not found
+ */
+unsigned int findlp(const xid *s, const struct radix_lptable *t)
+{
+	struct lpnode node;
+	uint32_t adr = 0, child;
+	int pos = 0, skip, last = -1;
+
+	for (;;) {
+		node = t->node[adr];
+		skip = node.link & LPSKIPMASK;
+		// A node at the end of the XID has no bits to compare and
+		// can read them from anywhere
+		if (xid_bits_u32(s, pos < XID_BITS ? pos : 0, skip) != node.bits)
+			break;
+		last = adr;
+		child = node.link >> LPLINKSHIFT;
+		if (0 == child)
+			break;
+		pos += skip;
+		if (node.link & LPCHAIN) {
+			adr = child;
+			continue;
+		}
+		adr = child + xid_bits_u32(s, pos, 1);
+		pos++;
+	}
+	return last < 0 ? 0 : t->nexthop[last];
+}
@@ -34,14 +34,38 @@ struct routtablerec *radix_create_fib(struct nextcreate *table,
 	assert(0 == fib_format(entry, table, size));
 
 	fib = buildrouttable(entry, size);
+	free(tmp_entry);
+	free(entry);
+	return fib;
+}
+
+/*
+ * Create the multibit variant of the table, which consumes stride bits per
+ * node, 1 to MAXSTRIDE
+ */
+struct radix_mbtable *radix_mb_create_fib(struct nextcreate *table,
+		unsigned long size, int stride)
+{
+	struct entryrec **entry = malloc(size * sizeof(struct entryrec *));
+	struct entryrec *tmp_entry = calloc(size, sizeof(struct entryrec));
+	struct radix_mbtable *fib = NULL;
+	int i;
+
+	for (i = 0; i < size; i++)
+		entry[i] = (tmp_entry + i);
+	assert(0 == fib_format(entry, table, size));
+
+	fib = buildmbtable(entry, size, stride);
+	free(tmp_entry);
 	free(entry);
 	return fib;
 }
 
 int radix_destroy_fib(struct routtablerec *rtable)
 {
-	free_trie(rtable->root);
+	free(rtable->node);
 	free(rtable->base);
+	free(rtable->pre);
 	free(rtable->nexthop);
 	free(rtable);
 
@@ -52,3 +76,61 @@ unsigned int lookup_radix(const xid *id, struct routtablerec *table, int opt)
 {
 	return find(*id, table, opt);
 }
+
+/*
+ * Create the leaf-pushed variant of the table, see leafpush.c
+ */
+struct radix_lptable *radix_lp_create_fib(struct nextcreate *table,
+		unsigned long size)
+{
+	struct entryrec **entry = malloc(size * sizeof(struct entryrec *));
+	struct entryrec *tmp_entry = calloc(size, sizeof(struct entryrec));
+	struct radix_lptable *fib = NULL;
+	int i;
+
+	for (i = 0; i < size; i++)
+		entry[i] = (tmp_entry + i);
+	assert(0 == fib_format(entry, table, size));
+
+	fib = buildlptable(entry, size);
+	free(tmp_entry);
+	free(entry);
+	return fib;
+}
+
+int radix_mb_destroy_fib(struct radix_mbtable *rtable)
+{
+	free(rtable->slot);
+	free(rtable->base);
+	free(rtable->pre);
+	free(rtable);
+
+	return 0;
+}
+
+/*
+ * Same as lookup_radix() on the multibit variant, opt is ignored
+ */
+unsigned int lookup_radix_mb(const xid *id, struct radix_mbtable *table,
+		int opt)
+{
+	return findmb(id, table);
+}
+
+int radix_lp_destroy_fib(struct radix_lptable *rtable)
+{
+	free(rtable->node);
+	free(rtable->nexthop);
+	free(rtable);
+
+	return 0;
+}
+
+/*
+ * Same as lookup_radix() on the leaf-pushed variant, opt is ignored
+ */
+unsigned int lookup_radix_lp(const xid *id, struct radix_lptable *table,
+		int opt)
+{
+	return findlp(id, table);
+}
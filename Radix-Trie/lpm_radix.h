@@ -17,9 +17,52 @@
 #define MINLENGTH 20
 #define MAXLENGTH 159
 
+/* Orders of the nodes in memory for radix_layout() */
+#define RADIX_LAYOUT_DFS 0	/* depth-first, the order they are built in */
+#define RADIX_LAYOUT_BFS 1	/* breadth-first */
+#define RADIX_LAYOUT_VEB 2	/* van Emde Boas */
+
 struct routtablerec *radix_create_fib(struct nextcreate *table,
 		unsigned long size);
 unsigned int lookup_radix(const xid *id, struct routtablerec *table, int opt);
 int radix_destroy_fib(struct routtablerec *rtable);
+int radix_layout(struct routtablerec *t, int layout);
+
+/* Default stride of the multibit variant */
+#define RADIX_STRIDE 8
+
+struct radix_mbtable *radix_mb_create_fib(struct nextcreate *table,
+		unsigned long size, int stride);
+unsigned int lookup_radix_mb(const xid *id, struct radix_mbtable *table,
+		int opt);
+int radix_mb_destroy_fib(struct radix_mbtable *rtable);
+
+struct radix_lptable *radix_lp_create_fib(struct nextcreate *table,
+		unsigned long size);
+unsigned int lookup_radix_lp(const xid *id, struct radix_lptable *table,
+		int opt);
+int radix_lp_destroy_fib(struct radix_lptable *rtable);
+
+/*
+ * A Radix trie that can be updated while lookups run on other threads, in
+ * update_table.c
+ */
+struct radix_dyntable;
+
+#define RADIX_INSERT 0
+#define RADIX_DELETE 1
+
+/* Number of threads that can look up a struct radix_dyntable */
+#define RADIX_MAXREADERS 64
+
+struct radix_dyntable *radix_dyn_create(struct nextcreate *table,
+		unsigned long size, unsigned long maxroutes);
+int radix_dyn_destroy(struct radix_dyntable *t);
+int radix_insert(struct radix_dyntable *t, const xid *prefix, int len,
+		unsigned int nexthop);
+int radix_delete(struct radix_dyntable *t, const xid *prefix, int len);
+int radix_dyn_reader(struct radix_dyntable *t);
+unsigned int radix_dyn_lookup(const xid *id, struct radix_dyntable *t,
+		int reader);
 
 #endif
@@ -0,0 +1,182 @@
+/*
+ * Garnaik Sumeet, Michel Machado 2015
+ * LPM Algorithms for Linux-XIA
+ *
+ * A multibit variant of the Radix trie that consumes stride bits per node.
+ *
+ * The entries that end within a node are expanded over all the slots they
+ * cover (controlled prefix expansion), so a lookup keeps the next-hop of the
+ * last slot it passed that had one. Below a slot where a single base vector
+ * entry is left, with or without prefixes of its own, the trie stops and the
+ * slot links to that entry, which is checked and falls back to its prefixes
+ * as in find(). A lookup reads at most XID_BITS / stride nodes instead of one
+ * node per bit.
+ */
+#include <assert.h>
+#include "xidsort.h"
+#include "radix.h"
+
+struct mbbuild
+{
+	struct entryrec **entry;	//The entries, sorted
+	int *nbases;			//Base vector entries before each entry
+	int stride;
+	struct mbslot *slot;
+	int nslots;
+	int maxslots;
+};
+
+/*
+ * Allocate an empty node and return the index of its first slot
+ */
+static uint32_t allocnode(struct mbbuild *m)
+{
+	uint32_t node = m->nslots;
+
+	if (m->nslots + (1 << m->stride) > m->maxslots) {
+		m->maxslots = 2 * m->maxslots + (1 << m->stride);
+		m->slot = realloc(m->slot, m->maxslots * sizeof(struct mbslot));
+		assert(m->slot);
+	}
+	memset(&m->slot[node], 0, (1 << m->stride) * sizeof(struct mbslot));
+	m->nslots += 1 << m->stride;
+	return node;
+}
+
+static uint32_t buildmbnode(struct mbbuild *m, int first, int last, int depth);
+
+/*
+ * Fill the node for the entries first to last - 1, which are longer than
+ * depth bits and share their first depth bits
+ */
+static void fillnode(struct mbbuild *m, uint32_t node, int first, int last,
+		int depth)
+{
+	int end = depth + m->stride;
+	struct entryrec *e;
+	uint32_t v, k, link;
+	int i, j;
+
+	for (i = first; i < last; i = j) {
+		e = m->entry[i];
+		v = xid_bits_u32(&e->data, depth, m->stride);
+		j = i + 1;
+		if (e->len <= end) {
+			// A prefix of an entry comes before it, so the longer
+			// entry is expanded last and keeps the slots
+			for (k = 0; k < (1U << (end - e->len)); k++)
+				m->slot[node + v + k].nexthop = e->nexthop;
+			continue;
+		}
+
+		// The longer entries of a slot are consecutive and the ones
+		// that end in the node come before all of them
+		while (j < last && m->entry[j]->len > end &&
+				xid_bits_u32(&m->entry[j]->data, depth,
+					m->stride) == v)
+			j++;
+		link = buildmbnode(m, i, j, end);
+		m->slot[node + v].link = link;
+	}
+}
+
+/*
+ * Return the link to the subtrie of the entries first to last - 1, which are
+ * longer than depth bits and share their first depth bits
+ */
+static uint32_t buildmbnode(struct mbbuild *m, int first, int last, int depth)
+{
+	uint32_t node;
+
+	// The only base vector entry of a range is its last entry, since the
+	// entries it has as prefixes come before it
+	if (1 == m->nbases[last] - m->nbases[first])
+		return (m->nbases[last] - 1) | RADIXLEAF;
+
+	node = allocnode(m);
+	fillnode(m, node, first, last, depth);
+	return node;
+}
+
+/*
+ * Build the multibit trie of the entries
+ *
+ * entry: array of entryrec pointers
+ * nentries: number of total entries
+ * stride: bits consumed per node, 1 to MAXSTRIDE
+ */
+struct radix_mbtable *buildmbtable(struct entryrec *entry[], int nentries,
+		int stride)
+{
+	struct radix_mbtable *table;
+	struct mbbuild m;
+	int i, first = 0;
+
+	assert(stride >= 1 && stride <= MAXSTRIDE);
+	table = malloc(sizeof(struct radix_mbtable));
+	table->stride = stride;
+	table->defnexthop = 0;
+
+	xidentrysort(entry, nentries, sizeof(struct entryrec *), compareentries);
+
+	// An entry is a base vector entry unless it is a prefix of the next one,
+	// as in buildvectors()
+	m.nbases = malloc((nentries + 1) * sizeof(int));
+	m.nbases[0] = 0;
+	for (i = 0; i < nentries; i++)
+		m.nbases[i + 1] = m.nbases[i] + !(i < nentries - 1 &&
+				isprefix(entry[i], entry[i + 1]));
+	m.entry = entry;
+	m.stride = stride;
+	m.slot = NULL;
+	m.nslots = 0;
+	m.maxslots = 0;
+
+	// The entry of length 0 is the first one and covers every XID
+	if (nentries > 0 && 0 == entry[0]->len) {
+		table->defnexthop = entry[0]->nexthop;
+		first = 1;
+	}
+	// The root is always a node, so a link of 0 can mean no child
+	allocnode(&m);
+	fillnode(&m, 0, first, nentries, 0);
+	free(m.nbases);
+
+	table->basesize = buildvectors(entry, nentries, &table->base,
+			&table->pre, &table->presize);
+	table->slot = realloc(m.slot, m.nslots * sizeof(struct mbslot));
+	table->nslots = m.nslots;
+	return table;
+}
+
+/*
+ * Return a nexthop or 0 if not found
+ */
+unsigned int findmb(const xid *s, const struct radix_mbtable *t)
+{
+	const struct mbslot *slot;
+	const struct baserec *b;
+	unsigned int nexthop = t->defnexthop;
+	uint32_t node = 0;
+	int pos = 0, lcp, rank;
+
+	for (;;) {
+		slot = &t->slot[node + xid_bits_u32(s, pos, t->stride)];
+		if (slot->nexthop)
+			nexthop = slot->nexthop;
+		if (ISLEAF(slot))
+			break;
+		if (0 == slot->link)
+			return nexthop;
+		node = slot->link;
+		pos += t->stride;
+	}
+
+	// The prefixes of the base XID cover the next-hops seen on the way
+	b = &t->base[GETBASE(slot)];
+	lcp = xid_lcp(&b->str, s);
+	if (lcp >= b->len)
+		return b->nexthop;
+	rank = xid_lenmap_rank(b->premap, lcp);
+	return rank ? t->pre[b->pre + rank - 1] : 0;
+}
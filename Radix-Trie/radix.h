@@ -13,13 +13,13 @@
 #include <float.h>
 #include <stdint.h>
 #include "../Data-Generation/generate_fibs.h"
+#include "../XID-Kernel/xid_kernel.h"
 
 #undef BYTE
 #define BYTE 8
 
 #define ADRSIZE 160 /* the number of bits in an address */
 
-typedef struct xid {unsigned char w[20];} xid;
 typedef xid *list;
 
 #define NOPRE -1          /* an empty prefix pointer */
@@ -43,21 +43,18 @@ struct entryrec
 	int pre;            /* this auxiliary variable is used in the */
 };                    /* construction of the final data structure */
 
-/* base vector */
+/*
+ * base vector, premap holds the lengths of the prefixes of str and their
+ * next-hops are stored in increasing length order from entry pre of the
+ * prefix vector
+ */
 struct baserec
 {
 	xid str;    /* the routing entry */
 	int len;     /* and its length */
-	int pre;     /* pointer to prefix table, -1 if no prefix */
+	int pre;     /* first next-hop of its prefixes, -1 if no prefix */
 	int nexthop;
-};
-
-/* prefix vector */
-struct prerec
-{
-	int len;     /* the length of the prefix */
-	int pre;     /* pointer to prefix, -1 if no prefix */
-	int nexthop; /* pointer to nexthop table */
+	uint64_t premap[XID_LENMAP_WORDS];
 };
 
 /*
@@ -66,59 +63,121 @@ struct prerec
  */
 struct routtablerec
 {
-	struct node_patric *root;
+	struct node_patric *node; /* the node arena, the root is node 0 */
+	int nnodes;
 	struct baserec *base;    /* the base vector */
 	int basesize;
-	struct prerec *pre;      /* the prefix vector */
+	unsigned int *pre;       /* the prefix vector */
 	int presize;
 	unsigned int *nexthop;   /* the next-hop table */
 	int nexthopsize;
 };
 
 /*
- * The structure of each node for building the path compressed trie from XIDs
+ * The structure of each node of the path compressed trie. All the nodes are
+ * stored in one array and the two children of an internal node are next to
+ * each other, so link is the index of the left child and the right one
+ * follows it. The link of a leaf is the index of its base vector entry with
+ * RADIXLEAF set.
  */
 struct node_patric
 {
-	int skip;
-	struct node_patric *left;
-	struct node_patric *right;
-	int base;
+	int32_t skip;
+	uint32_t link;
+} __attribute__((aligned(8)));
+
+#define RADIXLEAF 0x80000000U
+#define RADIXALIGN 64		/* alignment of the node arena */
+#define ISLEAF(node)		((node)->link & RADIXLEAF)
+#define GETBASE(node)		((node)->link & ~RADIXLEAF)
+
+/*
+ * A slot of a node of the multibit trie, where a node is 2^stride consecutive
+ * slots indexed by the next stride bits of the XID. link is the index of the
+ * first slot of the child node, the index of a base vector entry with
+ * RADIXLEAF set when only that entry and its prefixes are left below the slot,
+ * or 0 when there are no longer entries. nexthop is the next-hop of the
+ * longest entry that ends within the node and covers the slot, 0 if none.
+ */
+struct mbslot
+{
+	uint32_t link;
+	unsigned int nexthop;
+};
+
+/*
+ * The multibit trie variant of the routing table, which shares the base and
+ * prefix vectors with struct routtablerec
+ */
+struct radix_mbtable
+{
+	struct mbslot *slot;     /* the nodes, the root is the first one */
+	int nslots;
+	int stride;              /* bits consumed per node */
+	unsigned int defnexthop; /* next-hop of the entry of length 0 */
+	struct baserec *base;    /* the base vector */
+	int basesize;
+	unsigned int *pre;       /* the prefix vector */
+	int presize;
 };
 
-/* Extract operation for xids*/
-xid extract(int pos, int length, xid data);
+#define MAXSTRIDE 8
+
+/*
+ * A node of the leaf-pushed trie, which matches the next LPSKIP bits or less
+ * of the XID, starting where its parent left off, as the integer bits. link
+ * holds their number, LPCHAIN and the index of the child or, without
+ * LPCHAIN, of the pair of children the next bit selects, 0 if the node has
+ * no child. The next-hop of the longest entry that ends before the node
+ * branches, pushed down from its ancestors when no entry ends at the node
+ * itself, is kept apart since a lookup only reads it for the last node.
+ */
+struct lpnode
+{
+	uint32_t bits;
+	uint32_t link;
+} __attribute__((aligned(8)));
+
+#define LPSKIP 32
+#define LPSKIPMASK 0x3f
+#define LPCHAIN 0x40
+#define LPLINKSHIFT 7
+#define LPMAXNODES (1U << (32 - LPLINKSHIFT))
+
+/* The leaf-pushed variant of the routing table */
+struct radix_lptable
+{
+	struct lpnode *node;     /* the node arena, the root is node 0 */
+	unsigned int *nexthop;   /* the next-hop of each node */
+	int nnodes;
+};
 
-/* Remove bits from xids*/
-xid removexid(int bits, xid data);
 
 /* Increment xids*/
 int incrementxid(xid *pxid);
 
-/* Bitwise shifting operations on xids*/
-xid shift_left(xid id, int shift);
-xid shift_right(xid id, int shift);
+/* Order entries by XID and then by length */
+int compareentries(const void *id1, const void *id2);
+
+/* Is the entry s a prefix of the entry t? */
+int isprefix(struct entryrec *s, struct entryrec *t);
 
 /* Build the routing table */
+int buildvectors(struct entryrec *entry[], int nentries,
+		struct baserec **base, unsigned int **pre, int *npre);
 struct routtablerec *buildrouttable(struct entryrec *entry[], int nentries);
+struct radix_mbtable *buildmbtable(struct entryrec *entry[], int nentries,
+		int stride);
+struct radix_lptable *buildlptable(struct entryrec *entry[], int nentries);
 
 struct routtablerec *radixtrie_create_fib(struct nextcreate *table,
 		unsigned long size);
 
 int radixtrie_destroy_fib(struct routtablerec *rtable);
 
-/* 
- * Extract the 32 LSBs and cast to uint32_t
- */
-uint32_t xidtounsigned(xid *bitpat);
-
-/* 
- * Compare XIDs and return 0, 1, -1 depending on the values pointed by
- * dereferencing id1 and id2 twice.
- */
-int comparexid(const void *id1, const void *id2);
-
 /* Perform a lookup. */
 unsigned int find(xid s, struct routtablerec *t, int opt);
+unsigned int findmb(const xid *s, const struct radix_mbtable *t);
+unsigned int findlp(const xid *s, const struct radix_lptable *t);
 
 #endif
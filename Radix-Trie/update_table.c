@@ -0,0 +1,872 @@
+/*
+ * Garnaik Sumeet, Michel Machado 2015
+ * LPM Algorithms for Linux-XIA
+ *
+ * A Radix trie that can be updated while it is being looked up.
+ *
+ * The node arena and the base vector are allocated once with room to spare
+ * and never move. The prefix vector starts with room to spare as well, but an
+ * entry repeats all of its prefixes, so nested routes can need more of it than
+ * there are routes and it is copied to a larger one when a new run does not
+ * fit. A node is a single 64-bit word, so an update builds the new version of
+ * the smallest subtrie it changes in unused slots of the arrays and then
+ * publishes it with an atomic store of the word of the root of that subtrie,
+ * the root of the trie or a child of a node.
+ * Base vector entries and runs of the prefix vector are never changed once
+ * they can be reached: an entry whose prefixes change is copied.
+ *
+ * Lookups never take a lock. A lookup announces the epoch it starts in, and
+ * the nodes, entries and runs replaced by an update are kept until every
+ * lookup that started before the update has finished, which is the grace
+ * period of RCU.
+ */
+#include <assert.h>
+#include <pthread.h>
+#include "xidsort.h"
+#include "lpm_radix.h"
+
+#define RADIXEMPTY 0xffffffffU	/* link of the root of an empty trie */
+
+#define RETIREPAIR 0
+#define RETIREBASE 1
+#define RETIREPRE 2
+#define RETIREVEC 3
+
+/*
+ * A pair of nodes, a base vector entry, a run or a prefix vector replaced by
+ * an update
+ */
+struct radix_retired
+{
+	int kind;
+	uint32_t index;
+	unsigned int *vec;	//The prefix vector of RETIREVEC
+	uint64_t epoch;		//Epoch of the update that replaced it
+};
+
+/* A free range of the prefix vector */
+struct radix_hole
+{
+	int off;
+	int size;
+};
+
+/* Every reader has its own cache line */
+struct radix_reader
+{
+	uint64_t epoch;		//Epoch its lookup started in, 0 if none runs
+} __attribute__((aligned(64)));
+
+struct radix_dyntable
+{
+	struct routtablerec fib;	//nnodes, basesize: high water marks
+	int maxnodes;
+	int maxbases;
+	int maxpre;
+	uint32_t *freepair;
+	int nfreepairs;
+	int *freebase;
+	int nfreebases;
+	struct radix_hole *hole;	//Sorted by offset
+	int nholes;
+	int maxholes;
+	int *baserun;		//First entry of the run of each base entry
+	int *runsize;		//Size of each run by its first entry
+	int *runrefs;		//Base entries using each run
+	struct radix_retired *retired;
+	int nretired;
+	int maxretired;
+	uint64_t epoch;
+	struct radix_reader reader[RADIX_MAXREADERS];
+	int nreaders;
+	pthread_mutex_t lock;	//Serialises the writers
+};
+
+/* The nodes and base vector entries of a subtrie */
+struct subtrie
+{
+	uint32_t *pair;
+	int npairs;
+	int *base;
+	int nbases;
+};
+
+static void readnode(const struct node_patric *node, struct node_patric *n)
+{
+	__atomic_load(node, n, __ATOMIC_ACQUIRE);
+}
+
+static void publish(struct node_patric *node, struct node_patric *n)
+{
+	__atomic_store(node, n, __ATOMIC_RELEASE);
+}
+
+/*
+ * Return the first index of a free pair of nodes, or 0 if the arena is full
+ */
+static uint32_t allocpair(struct radix_dyntable *d)
+{
+	uint32_t pair;
+
+	if (d->nfreepairs > 0)
+		return d->freepair[--d->nfreepairs];
+	if (d->fib.nnodes + 2 > d->maxnodes)
+		return 0;
+	pair = d->fib.nnodes;
+	d->fib.nnodes += 2;
+	return pair;
+}
+
+static int freepairs(const struct radix_dyntable *d)
+{
+	return d->nfreepairs + (d->maxnodes - d->fib.nnodes) / 2;
+}
+
+/*
+ * Return the index of a free base vector entry, or NOBASE if there is none
+ */
+static int allocbase(struct radix_dyntable *d)
+{
+	if (d->nfreebases > 0)
+		return d->freebase[--d->nfreebases];
+	if (d->fib.basesize == d->maxbases)
+		return NOBASE;
+	return d->fib.basesize++;
+}
+
+static int freebases(const struct radix_dyntable *d)
+{
+	return d->nfreebases + d->maxbases - d->fib.basesize;
+}
+
+/*
+ * Return the first entry of a free run of n entries of the prefix vector, the
+ * first one that fits, or NOPRE if there is none
+ */
+static int allocrun(struct radix_dyntable *d, int n)
+{
+	int i, off;
+
+	for (i = 0; i < d->nholes; i++) {
+		if (d->hole[i].size < n)
+			continue;
+		off = d->hole[i].off;
+		d->hole[i].off += n;
+		d->hole[i].size -= n;
+		if (0 == d->hole[i].size) {
+			memmove(&d->hole[i], &d->hole[i + 1],
+					(d->nholes - i - 1) * sizeof(*d->hole));
+			d->nholes--;
+		}
+		d->runsize[off] = n;
+		d->runrefs[off] = 0;
+		return off;
+	}
+	return NOPRE;
+}
+
+/*
+ * Give the run at off back to the prefix vector, merging it with the holes
+ * next to it
+ */
+static void freerun(struct radix_dyntable *d, int off)
+{
+	int size = d->runsize[off];
+	int i = 0;
+
+	while (i < d->nholes && d->hole[i].off < off)
+		i++;
+	if (i > 0 && d->hole[i - 1].off + d->hole[i - 1].size == off) {
+		d->hole[i - 1].size += size;
+		if (i < d->nholes && off + size == d->hole[i].off) {
+			d->hole[i - 1].size += d->hole[i].size;
+			memmove(&d->hole[i], &d->hole[i + 1],
+					(d->nholes - i - 1) * sizeof(*d->hole));
+			d->nholes--;
+		}
+		return;
+	}
+	if (i < d->nholes && off + size == d->hole[i].off) {
+		d->hole[i].off = off;
+		d->hole[i].size += size;
+		return;
+	}
+	if (d->nholes == d->maxholes) {
+		d->maxholes = 2 * d->maxholes + 16;
+		d->hole = realloc(d->hole, d->maxholes * sizeof(*d->hole));
+		assert(d->hole);
+	}
+	memmove(&d->hole[i + 1], &d->hole[i], (d->nholes - i) * sizeof(*d->hole));
+	d->hole[i].off = off;
+	d->hole[i].size = size;
+	d->nholes++;
+}
+
+static void retire(struct radix_dyntable *d, int kind, uint32_t index)
+{
+	if (d->nretired == d->maxretired) {
+		d->maxretired = 2 * d->maxretired + 64;
+		d->retired = realloc(d->retired,
+				d->maxretired * sizeof(struct radix_retired));
+		assert(d->retired);
+	}
+	d->retired[d->nretired].kind = kind;
+	d->retired[d->nretired].index = index;
+	d->retired[d->nretired].vec = NULL;
+	d->retired[d->nretired].epoch = d->epoch;
+	d->nretired++;
+}
+
+/*
+ * Make room for a run of n entries at the end of the prefix vector. The
+ * lookups that started before go on reading the old vector, so it is copied
+ * and retired, and the new one is published before any node that leads to
+ * the entries past the end of the old one.
+ */
+static void growpre(struct radix_dyntable *d, int n)
+{
+	unsigned int *pre;
+	int oldmax = d->maxpre;
+
+	assert(n <= INT32_MAX / 2 - oldmax);
+	d->maxpre = n > oldmax ? oldmax + n : 2 * oldmax;
+	pre = malloc(d->maxpre * sizeof(unsigned int));
+	d->runsize = realloc(d->runsize, d->maxpre * sizeof(int));
+	d->runrefs = realloc(d->runrefs, d->maxpre * sizeof(int));
+	assert(pre && d->runsize && d->runrefs);
+	memcpy(pre, d->fib.pre, oldmax * sizeof(unsigned int));
+	retire(d, RETIREVEC, 0);
+	d->retired[d->nretired - 1].vec = d->fib.pre;
+	__atomic_store_n(&d->fib.pre, pre, __ATOMIC_RELEASE);
+
+	// The new entries are one run given back to the prefix vector
+	d->runsize[oldmax] = d->maxpre - oldmax;
+	freerun(d, oldmax);
+}
+
+/*
+ * Retire base vector entry b and its run once no other entry uses it
+ */
+static void retirebase(struct radix_dyntable *d, int b)
+{
+	int run = d->baserun[b];
+
+	retire(d, RETIREBASE, b);
+	if (run != NOPRE && 0 == --d->runrefs[run])
+		retire(d, RETIREPRE, run);
+}
+
+/*
+ * Free what was retired before the oldest running lookup started
+ */
+static void reclaim(struct radix_dyntable *d)
+{
+	uint64_t oldest = UINT64_MAX, e;
+	struct radix_retired *r;
+	int i, n = 0;
+	int nreaders = __atomic_load_n(&d->nreaders, __ATOMIC_ACQUIRE);
+
+	// Pairs with the fence of radix_dyn_lookup(): a lookup whose epoch is
+	// not seen here reads the nodes published before
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	for (i = 0; i < nreaders; i++) {
+		e = __atomic_load_n(&d->reader[i].epoch, __ATOMIC_SEQ_CST);
+		if (e && e < oldest)
+			oldest = e;
+	}
+
+	for (i = 0; i < d->nretired; i++) {
+		r = &d->retired[i];
+		if (r->epoch >= oldest) {
+			d->retired[n++] = *r;
+			continue;
+		}
+		switch (r->kind) {
+		case RETIREPAIR:
+			d->freepair[d->nfreepairs++] = r->index;
+			break;
+		case RETIREBASE:
+			d->freebase[d->nfreebases++] = r->index;
+			break;
+		case RETIREPRE:
+			freerun(d, r->index);
+			break;
+		case RETIREVEC:
+			free(r->vec);
+			break;
+		}
+	}
+	d->nretired = n;
+}
+
+/*
+ * End an update whose changes are published and whose replaced parts are
+ * retired: later lookups start in a new epoch and cannot reach them
+ */
+static void endupdate(struct radix_dyntable *d)
+{
+	__atomic_add_fetch(&d->epoch, 1, __ATOMIC_SEQ_CST);
+	reclaim(d);
+}
+
+static void addpair(struct subtrie *s, uint32_t pair)
+{
+	if (0 == (s->npairs & (s->npairs - 1)))
+		s->pair = realloc(s->pair, 2 * (s->npairs + 1) * sizeof(uint32_t));
+	s->pair[s->npairs++] = pair;
+}
+
+static void addbase(struct subtrie *s, int base)
+{
+	if (0 == (s->nbases & (s->nbases - 1)))
+		s->base = realloc(s->base, 2 * (s->nbases + 1) * sizeof(int));
+	s->base[s->nbases++] = base;
+}
+
+/*
+ * Collect the pairs and base vector entries of the subtrie of node n, in the
+ * order of their XIDs
+ */
+static void collect(const struct radix_dyntable *d, const struct node_patric *n,
+		struct subtrie *s)
+{
+	if (ISLEAF(n)) {
+		addbase(s, GETBASE(n));
+		return;
+	}
+	addpair(s, n->link);
+	collect(d, &d->fib.node[n->link], s);
+	collect(d, &d->fib.node[n->link + 1], s);
+}
+
+/*
+ * Copy node i of the trie of t and its subtrie into free pairs of the arena,
+ * where base vector entry j of t is entry newbase[j]. The copy is not
+ * reachable until its root is published.
+ */
+static struct node_patric copynode(struct radix_dyntable *d,
+		const struct routtablerec *t, uint32_t i, const int *newbase)
+{
+	struct node_patric n = t->node[i];
+	uint32_t pair;
+
+	if (ISLEAF(&n)) {
+		n.link = newbase[GETBASE(&n)] | RADIXLEAF;
+		return n;
+	}
+	pair = allocpair(d);
+	d->fib.node[pair] = copynode(d, t, n.link, newbase);
+	d->fib.node[pair + 1] = copynode(d, t, n.link + 1, newbase);
+	n.link = pair;
+	return n;
+}
+
+/*
+ * Add the routes that base vector entry b stands for, the entry itself and
+ * its prefixes, to route
+ */
+static int baseroutes(const struct radix_dyntable *d, const struct baserec *b,
+		struct entryrec *route)
+{
+	struct xid_words w;
+	int len, n = 0;
+
+	for (len = 0; len < b->len; len++) {
+		if (!(b->premap[len >> 6] & ((uint64_t) 1 << (len & 63))))
+			continue;
+		xid_load(&w, &b->str);
+		xidw_mask(&w, len);
+		xid_store(&route[n].data, &w);
+		route[n].len = len;
+		route[n].nexthop = d->fib.pre[b->pre + n];
+		n++;
+	}
+	route[n].data = b->str;
+	route[n].len = b->len;
+	route[n].nexthop = b->nexthop;
+	return n + 1;
+}
+
+/*
+ * Rebuild the subtrie of node x, whose XIDs have their first prefix bits in
+ * common, with the route data/len inserted with the given next-hop or, if op
+ * is RADIX_DELETE, deleted, and publish it. The subtrie must hold every base
+ * vector entry that has the route as a prefix and the place of the route.
+ *
+ * A deletion that leaves no route of at least prefix bits in the subtrie
+ * removes node x, so the node parent and its other child are replaced by that
+ * child. The routes shorter than prefix bits are prefixes of the other child.
+ *
+ * Return 1 if the table changed, 0 if not and -1 if the node arena or the
+ * base vector is full.
+ */
+static int rebuild(struct radix_dyntable *d, uint32_t x, int prefix,
+		int parent, const xid *data, int len, unsigned int nexthop,
+		int op)
+{
+	struct node_patric old, n, p, sibling;
+	struct subtrie s = {NULL, 0, NULL, 0};
+	struct entryrec *route, **entry, key, *keyp = &key;
+	struct routtablerec *t;
+	int *newbase;
+	int i, nroutes = 0, nentries, owned, found = -1, ret = 1, run;
+
+	old = d->fib.node[x];
+	collect(d, &old, &s);
+	for (i = 0; i < s.nbases; i++)
+		nroutes += 1 + xid_lenmap_rank(d->fib.base[s.base[i]].premap,
+				ADRSIZE);
+	route = malloc((nroutes + 1) * sizeof(struct entryrec));
+	entry = malloc((nroutes + 1) * sizeof(struct entryrec *));
+	nroutes = 0;
+	for (i = 0; i < s.nbases; i++)
+		nroutes += baseroutes(d, &d->fib.base[s.base[i]],
+				&route[nroutes]);
+
+	// The entries that share prefixes repeat them
+	for (i = 0; i < nroutes; i++)
+		entry[i] = &route[i];
+	qsort(entry, nroutes, sizeof(struct entryrec *), compareentries);
+	key.data = *data;
+	key.len = len;
+	nentries = 0;
+	for (i = 0; i < nroutes; i++) {
+		if (nentries > 0 &&
+				0 == compareentries(&entry[nentries - 1], &entry[i]))
+			continue;
+		if (0 == compareentries(&entry[i], &keyp))
+			found = nentries;
+		entry[nentries++] = entry[i];
+	}
+
+	if (RADIX_DELETE == op) {
+		if (found < 0)
+			ret = 0;
+		else
+			entry[found] = entry[--nentries];
+	} else if (found >= 0) {
+		if (entry[found]->nexthop == nexthop)
+			ret = 0;
+		entry[found]->nexthop = nexthop;
+	} else {
+		route[nroutes] = key;
+		route[nroutes].nexthop = nexthop;
+		entry[nentries++] = &route[nroutes];
+	}
+	if (0 == ret)
+		goto out;
+
+	owned = 0;
+	for (i = 0; i < nentries; i++)
+		owned += entry[i]->len >= prefix;
+	if (0 == owned) {
+		// Node x goes away with its base vector entry
+		if (parent < 0) {
+			n.skip = 0;
+			n.link = RADIXEMPTY;
+			publish(&d->fib.node[0], &n);
+		} else {
+			p = d->fib.node[parent];
+			sibling = d->fib.node[p.link + (x == p.link)];
+			n.skip = p.skip + 1 + sibling.skip;
+			n.link = sibling.link;
+			publish(&d->fib.node[parent], &n);
+			retire(d, RETIREPAIR, p.link);
+		}
+		goto retireold;
+	}
+
+	t = buildrouttable(entry, nentries);
+	if (t->basesize - 1 > freepairs(d) || t->basesize > freebases(d)) {
+		radix_destroy_fib(t);
+		ret = -1;
+		goto out;
+	}
+
+	// The runs of the old subtrie are still in use, so the prefix vector
+	// may have to grow for the new one
+	run = NOPRE;
+	if (t->presize > 0) {
+		run = allocrun(d, t->presize);
+		if (NOPRE == run) {
+			growpre(d, t->presize);
+			run = allocrun(d, t->presize);
+		}
+		memcpy(&d->fib.pre[run], t->pre,
+				t->presize * sizeof(unsigned int));
+	}
+	newbase = malloc(t->basesize * sizeof(int));
+	for (i = 0; i < t->basesize; i++) {
+		newbase[i] = allocbase(d);
+		d->fib.base[newbase[i]] = t->base[i];
+		d->baserun[newbase[i]] = NOPRE;
+		if (t->base[i].pre != NOPRE) {
+			d->fib.base[newbase[i]].pre += run;
+			d->baserun[newbase[i]] = run;
+			d->runrefs[run]++;
+		}
+	}
+
+	// The trie of t starts at bit 0 and the subtrie at bit prefix
+	n = copynode(d, t, 0, newbase);
+	n.skip -= prefix;
+	publish(&d->fib.node[x], &n);
+	free(newbase);
+	radix_destroy_fib(t);
+
+retireold:
+	for (i = 0; i < s.npairs; i++)
+		retire(d, RETIREPAIR, s.pair[i]);
+	for (i = 0; i < s.nbases; i++)
+		retirebase(d, s.base[i]);
+out:
+	free(s.pair);
+	free(s.base);
+	free(entry);
+	free(route);
+	return ret;
+}
+
+/*
+ * Return a new base vector entry for the route data/len with the prefixes
+ * that base vector entry b has up to bit lcp, sharing their run, or NOBASE
+ * if the base vector is full. b is NOBASE for no prefixes.
+ */
+static int newentry(struct radix_dyntable *d, const xid *data, int len,
+		unsigned int nexthop, int b, int lcp)
+{
+	struct baserec *e;
+	int newb, w;
+
+	newb = allocbase(d);
+	if (NOBASE == newb)
+		return NOBASE;
+	e = &d->fib.base[newb];
+	e->str = *data;
+	e->len = len;
+	e->nexthop = nexthop;
+	e->pre = NOPRE;
+	d->baserun[newb] = NOPRE;
+	memset(e->premap, 0, sizeof(e->premap));
+	if (NOBASE == b)
+		return newb;
+
+	memcpy(e->premap, d->fib.base[b].premap, sizeof(e->premap));
+	w = lcp >> 6;
+	e->premap[w] &= ~(uint64_t) 0 >> (63 - (lcp & 63));
+	while (++w < XID_LENMAP_WORDS)
+		e->premap[w] = 0;
+	if (xid_lenmap_rank(e->premap, ADRSIZE) > 0) {
+		e->pre = d->fib.base[b].pre;
+		d->baserun[newb] = d->baserun[b];
+		d->runrefs[d->baserun[b]]++;
+	}
+	return newb;
+}
+
+/*
+ * Insert the route data/len where it branches off the path to node x at bit
+ * lcp, which is past the first prefix bits of the subtrie of x and before the
+ * bit x tests, so no entry of the subtrie has the route as a prefix. Its
+ * prefixes are the ones base vector entry b, which is in the subtrie, has up
+ * to bit lcp.
+ */
+static int split(struct radix_dyntable *d, uint32_t x, int prefix, int lcp,
+		const xid *data, int len, unsigned int nexthop, int b)
+{
+	struct node_patric n, old = d->fib.node[x];
+	uint32_t pair;
+	int newb, side;
+
+	if (freepairs(d) < 1 || freebases(d) < 1)
+		return -1;
+	newb = newentry(d, data, len, nexthop, b, lcp);
+
+	// The route and the old subtrie become the children of x at bit lcp
+	pair = allocpair(d);
+	side = xid_bits_u32(data, lcp, 1);
+	d->fib.node[pair + side].skip = len - lcp - 1;
+	d->fib.node[pair + side].link = newb | RADIXLEAF;
+	d->fib.node[pair + !side].skip = old.skip + prefix - lcp - 1;
+	d->fib.node[pair + !side].link = old.link;
+	n.skip = lcp - prefix;
+	n.link = pair;
+	publish(&d->fib.node[x], &n);
+	return 1;
+}
+
+/*
+ * Insert or delete a route, see rebuild()
+ */
+static int update(struct radix_dyntable *d, const xid *prefix, int len,
+		unsigned int nexthop, int op)
+{
+	const struct node_patric *node = d->fib.node;
+	const struct baserec *b;
+	struct node_patric n;
+	struct xid_words w;
+	xid data;
+	uint32_t x;
+	int parent, pos, lcp, stop, ret;
+
+	assert(len >= 0 && len <= ADRSIZE);
+	// The bits past the length of a route are not part of it
+	xid_load(&w, prefix);
+	xidw_mask(&w, len);
+	xid_store(&data, &w);
+
+	pthread_mutex_lock(&d->lock);
+	if (RADIXEMPTY == node[0].link) {
+		ret = 0;
+		if (RADIX_INSERT == op) {
+			n.skip = len;
+			n.link = newentry(d, &data, len, nexthop, NOBASE, 0);
+			ret = NOBASE == (int) n.link ? -1 : 1;
+			n.link |= RADIXLEAF;
+			if (ret > 0)
+				publish(&d->fib.node[0], &n);
+		}
+		goto out;
+	}
+
+	// The leaf the route leads to has the longest prefix in common with
+	// it of all the base vector entries
+	n = node[0];
+	pos = n.skip;
+	while (!ISLEAF(&n)) {
+		n = node[n.link + xid_bits_u32(&data, pos, 1)];
+		pos += 1 + n.skip;
+	}
+	b = &d->fib.base[GETBASE(&n)];
+	lcp = xid_lcp(&b->str, &data);
+	if (RADIX_DELETE == op && (lcp < len || len > b->len ||
+			(len < b->len && !(b->premap[len >> 6] &
+				((uint64_t) 1 << (len & 63)))))) {
+		ret = 0;
+		goto out;
+	}
+
+	// Go down to the first node that tests a bit past the route or past
+	// the bits it has in common with the XIDs below
+	stop = lcp < len ? lcp : len;
+	x = 0;
+	parent = -1;
+	pos = 0;
+	n = node[0];
+	while (!ISLEAF(&n) && pos + n.skip < stop) {
+		parent = x;
+		pos += n.skip;
+		x = n.link + xid_bits_u32(&data, pos, 1);
+		pos++;
+		n = node[x];
+	}
+
+	if (RADIX_INSERT == op && lcp < len && (!ISLEAF(&n) || lcp < b->len))
+		ret = split(d, x, pos, lcp, &data, len, nexthop,
+				b - d->fib.base);
+	else
+		ret = rebuild(d, x, pos, parent, &data, len, nexthop, op);
+out:
+	if (ret > 0)
+		endupdate(d);
+	pthread_mutex_unlock(&d->lock);
+	return ret;
+}
+
+/*
+ * Insert the route prefix/len with the given next-hop, or replace the
+ * next-hop of the route if it is already present
+ *
+ * Return 1 if the table changed, 0 if not and -1 if the table is full. A table
+ * that holds fewer than the maxroutes routes of radix_dyn_create() is only
+ * full if lookups that run for many updates keep the nodes they replace.
+ */
+int radix_insert(struct radix_dyntable *t, const xid *prefix, int len,
+		unsigned int nexthop)
+{
+	return update(t, prefix, len, nexthop, RADIX_INSERT);
+}
+
+/*
+ * Delete the route prefix/len
+ *
+ * Return 1 if the table changed, 0 if the route is not present and -1 if the
+ * table is full.
+ */
+int radix_delete(struct radix_dyntable *t, const xid *prefix, int len)
+{
+	return update(t, prefix, len, 0, RADIX_DELETE);
+}
+
+/*
+ * Create an updatable table from the routes in table with room for maxroutes
+ * routes, maxroutes being at least size. The node arena and the base vector
+ * are twice as large as maxroutes needs, so that updates can build new nodes
+ * while the ones they replace wait for their grace period, and the prefix
+ * vector grows as the prefixes of the routes need.
+ */
+struct radix_dyntable *radix_dyn_create(struct nextcreate *table,
+		unsigned long size, unsigned long maxroutes)
+{
+	struct radix_dyntable *d;
+	struct routtablerec *t = NULL;
+	struct entryrec **entry, *tmp_entry;
+	unsigned long i, n = 0;
+	int b;
+
+	assert(maxroutes >= size && maxroutes > 0 && maxroutes <= INT32_MAX / 4);
+	d = calloc(1, sizeof(struct radix_dyntable));
+	d->maxnodes = 4 * maxroutes - 1;
+	d->maxbases = 2 * maxroutes;
+	d->maxpre = 4 * maxroutes;
+
+	// A route given twice keeps its first next-hop
+	entry = malloc(size * sizeof(struct entryrec *));
+	tmp_entry = calloc(size, sizeof(struct entryrec));
+	for (i = 0; i < size; i++) {
+		memcpy(tmp_entry[i].data.w, table[i].prefix, HEXXID);
+		tmp_entry[i].len = table[i].len;
+		tmp_entry[i].nexthop = table[i].nexthop;
+		entry[i] = &tmp_entry[i];
+	}
+	xidentrysort(entry, size, sizeof(struct entryrec *), compareentries);
+	for (i = 0; i < size; i++) {
+		if (0 == n || compareentries(&entry[n - 1], &entry[i]))
+			entry[n++] = entry[i];
+	}
+	if (n > 0) {
+		t = buildrouttable(entry, n);
+		if (2 * t->presize > d->maxpre)
+			d->maxpre = 2 * t->presize;
+	}
+	free(tmp_entry);
+	free(entry);
+
+	assert(0 == posix_memalign((void **) &d->fib.node, RADIXALIGN,
+				d->maxnodes * sizeof(struct node_patric)));
+	d->fib.base = malloc(d->maxbases * sizeof(struct baserec));
+	d->fib.pre = malloc(d->maxpre * sizeof(unsigned int));
+	d->freepair = malloc(d->maxnodes / 2 * sizeof(uint32_t));
+	d->freebase = malloc(d->maxbases * sizeof(int));
+	d->baserun = malloc(d->maxbases * sizeof(int));
+	d->runsize = malloc(d->maxpre * sizeof(int));
+	d->runrefs = malloc(d->maxpre * sizeof(int));
+	d->fib.nnodes = 1;
+	d->fib.node[0].skip = 0;
+	d->fib.node[0].link = RADIXEMPTY;
+	d->hole = malloc(sizeof(struct radix_hole));
+	d->hole[0].off = 0;
+	d->hole[0].size = d->maxpre;
+	d->nholes = 1;
+	d->maxholes = 1;
+	d->epoch = 1;
+	assert(0 == pthread_mutex_init(&d->lock, NULL));
+	if (NULL == t)
+		return d;
+
+	// The prefix vector of the built table is the first run
+	memcpy(d->fib.node, t->node, t->nnodes * sizeof(struct node_patric));
+	memcpy(d->fib.base, t->base, t->basesize * sizeof(struct baserec));
+	d->fib.nnodes = t->nnodes;
+	d->fib.basesize = t->basesize;
+	if (t->presize > 0) {
+		assert(0 == allocrun(d, t->presize));
+		memcpy(d->fib.pre, t->pre, t->presize * sizeof(unsigned int));
+	}
+	for (b = 0; b < t->basesize; b++) {
+		d->baserun[b] = NOPRE;
+		if (t->base[b].pre != NOPRE) {
+			d->baserun[b] = 0;
+			d->runrefs[0]++;
+		}
+	}
+	radix_destroy_fib(t);
+	return d;
+}
+
+int radix_dyn_destroy(struct radix_dyntable *t)
+{
+	int i;
+
+	free(t->fib.node);
+	free(t->fib.base);
+	free(t->fib.pre);
+	free(t->freepair);
+	free(t->freebase);
+	free(t->baserun);
+	free(t->runsize);
+	free(t->runrefs);
+	free(t->hole);
+	for (i = 0; i < t->nretired; i++) {
+		if (RETIREVEC == t->retired[i].kind)
+			free(t->retired[i].vec);
+	}
+	free(t->retired);
+	pthread_mutex_destroy(&t->lock);
+	free(t);
+
+	return 0;
+}
+
+/*
+ * Return the number of a new reader, to be used by one thread at a time for
+ * its lookups, or -1 if there are RADIX_MAXREADERS already
+ */
+int radix_dyn_reader(struct radix_dyntable *t)
+{
+	int r = __atomic_fetch_add(&t->nreaders, 1, __ATOMIC_ACQ_REL);
+
+	if (r >= RADIX_MAXREADERS) {
+		__atomic_fetch_sub(&t->nreaders, 1, __ATOMIC_ACQ_REL);
+		return -1;
+	}
+	return r;
+}
+
+/*
+ * Same as find() on a trie that is being updated, where every node is read
+ * once with an atomic load
+ */
+static unsigned int finddyn(const xid *s, const struct routtablerec *t)
+{
+	const struct baserec *b;
+	struct node_patric n;
+	int pos, lcp, rank;
+
+	readnode(&t->node[0], &n);
+	if (RADIXEMPTY == n.link)
+		return 0;
+	pos = n.skip;
+	while (!ISLEAF(&n)) {
+		readnode(&t->node[n.link + xid_bits_u32(s, pos, 1)], &n);
+		pos += 1 + n.skip;
+	}
+
+	b = &t->base[GETBASE(&n)];
+	lcp = xid_lcp(&b->str, s);
+	if (lcp >= b->len)
+		return b->nexthop;
+	rank = xid_lenmap_rank(b->premap, lcp);
+	// The entry was published after the prefix vector that holds its run
+	return rank ? __atomic_load_n(&t->pre, __ATOMIC_ACQUIRE)[b->pre +
+		rank - 1] : 0;
+}
+
+/*
+ * Look up id on behalf of the given reader, see radix_dyn_reader()
+ */
+unsigned int radix_dyn_lookup(const xid *id, struct radix_dyntable *t,
+		int reader)
+{
+	struct radix_reader *r = &t->reader[reader];
+	unsigned int nexthop;
+
+	// Nothing the lookup reads can be freed once the writers see its
+	// epoch, so the epoch is visible before the first node is read
+	__atomic_store_n(&r->epoch, __atomic_load_n(&t->epoch,
+				__ATOMIC_ACQUIRE), __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	nexthop = finddyn(id, &t->fib);
+	__atomic_store_n(&r->epoch, 0, __ATOMIC_RELEASE);
+	return nexthop;
+}
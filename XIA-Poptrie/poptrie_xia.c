@@ -1,19 +1,5 @@
 #include "poptrie_xia.h"
 
-/*
- * Converts an xid to corresponding integer value. Assumes that the number of
- * bits and positions of initial bit are all valid. Any non-valid arguments will
- * result in arbitrary behaviour
- *
- * NOTE: Non-Optimized. Feel free to optimize the way you want
- */
-static uint32_t _xid_to_u32(xid addr, int start, int bits)
-{
-	xid tmp = extractXID(start, bits, addr);
-	uint32_t utmp = XIDtounsigned(&tmp);
-	return utmp;
-}
-
 /*
  * Looks up the longest prefix matching entry in Poptrie and returns the
  * corresponding nexthop address
@@ -25,7 +11,7 @@ int poptrie_xia_lookup(struct poptrie *poptrie, xid prefix, uint16_t *nexthop)
 	int pos;
 	int inode;
 
-	index = _xid_to_u32(prefix, 0, POPTRIE_DP);
+	index = xid_bits_u32(&prefix, 0, POPTRIE_DP);
 	pos = POPTRIE_DP;
 
 	if (poptrie->direct_pointer[index] & ((uint32_t) 1 << 31)) {
@@ -33,7 +19,7 @@ int poptrie_xia_lookup(struct poptrie *poptrie, xid prefix, uint16_t *nexthop)
 		return PASSED;
 	} else {
 		base = poptrie->direct_pointer[index];
-		index = _xid_to_u32(prefix, pos, M_ARY);
+		index = xid_bits_u32(&prefix, pos, M_ARY);
 		pos += M_ARY;
 	}
 	// Needs to traverse through Poptrie
@@ -71,14 +57,14 @@ int poptrie_xia_add(struct poptrie *poptrie, xid prefix, unsigned int len,
 	if (len < POPTRIE_DP) {
 		// Insert into direct pointer without need to set the proper
 		// bits for accessing nodes below the trie
-		val = _xid_to_u32(prefix, 0, POPTRIE_DP);
+		val = xid_bits_u32(&prefix, 0, POPTRIE_DP);
 		*(poptrie->direct_pointer + val) = next;
 		SET_BIT_DP((poptrie->direct_pointer + val));
 	} else if (POPTRIE_DP == len) {
 		// Insert into direct pointer and set the right bits for
 		// fib entries. Setting them different for alternate direct
 		// pointer in further revisions
-		val = _xid_to_u32(prefix, 0, len);
+		val = xid_bits_u32(&prefix, 0, len);
 		*(poptrie->direct_pointer + val) = next;
 		SET_BIT_DP((poptrie->direct_pointer + val));
 	} else {
@@ -7,6 +7,7 @@
 #include <unistd.h>
 #include <stdint.h>
 #include <assert.h>
+#include "../XID-Kernel/xid_kernel.h"
 
 #define PASSED 0
 #define FAILED -1
@@ -18,10 +19,6 @@
 #define SET_BIT_DP(dp) (*(dp) = *(dp) | (1 << 31))
 #define popcnt(v) __builtin_popcountll(v)
 
-typedef struct xid {
-	unsigned char w[20];
-} xid;
-
 struct poptrie_fib {
 	uint16_t *entries;
 	int n;
@@ -61,13 +58,4 @@ struct poptrie *poptrie_xia_init(struct poptrie *poptrie, int nodes,
 		int leaves);
 int poptrie_xia_destroy(struct poptrie *poptrie);
 
-/*
- * In xid_operation.c
- */
-xid extractXID(int pos, int length, xid data);
-xid removeXID(int bits, xid data);
-xid shift_left(xid id, int shift);
-xid shift_right(xid id, int shift);
-uint32_t XIDtounsigned(xid *bitpat);
-
 #endif
@@ -0,0 +1,94 @@
+/*
+ * Garnaik Sumeet, Michel Machado 2015
+ * LPM Algorithms for Linux-XIA
+ */
+#include "xid_kernel.h"
+
+/*
+ * Bitwise shift left an XID by shift bits and return that shifted XID
+ */
+xid shift_left(xid id, int shift)
+{
+	struct xid_words x;
+
+	xid_load(&x, &id);
+	xidw_shl(&x, shift);
+	xid_store(&id, &x);
+	return id;
+}
+
+/*
+ * Bitwise shift right an XID by shift bits and return that shifted XID
+ */
+xid shift_right(xid id, int shift)
+{
+	struct xid_words x;
+
+	xid_load(&x, &id);
+	xidw_shr(&x, shift);
+	xid_store(&id, &x);
+	return id;
+}
+
+/*
+ * Extract length bits starting at pos from data
+ */
+xid extract(int pos, int length, xid data)
+{
+	struct xid_words x;
+
+	// length = 0 is handled in the boolean expression and is short-circuit
+	// even though length of zero works in case of xids
+	xid_load(&x, &data);
+	xidw_shl(&x, pos);
+	xidw_shr(&x, XID_BITS - length);
+	xid_store(&data, &x);
+	return data;
+}
+
+/*
+ * Remove "bits" bits from data
+ */
+xid removexid(int bits, xid data)
+{
+	struct xid_words x;
+
+	xid_load(&x, &data);
+	xidw_unmask(&x, bits);
+	xid_store(&data, &x);
+	return data;
+}
+
+/*
+ * Compare two xids i.e 160-bit addresses and returns 1, 0, -1 
+ * 
+ * id1 > id2 : return 1
+ * id1 < id2 : return -1
+ * id1 = id2 : return 0
+ */
+int comparexid(const void *id1, const void *id2)
+{
+	int tmpresult;
+	xid **tmp1 = (xid **)id1;
+	xid **tmp2 = (xid **)id2;
+
+	tmpresult = memcmp(*tmp1, *tmp2, XID_BYTES);
+
+	if (tmpresult < 0)
+		return -1;
+	else if (tmpresult > 0)
+		return 1;
+	else
+		return 0;
+}
+
+/*
+ * Convert and XID to uint32_t
+ */
+uint32_t xidtounsigned(xid *bitpat)
+{
+	uint32_t tmp;
+
+	memcpy(&tmp, bitpat->w + 16, 4);
+	return be32toh(tmp);
+}
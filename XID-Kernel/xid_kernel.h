@@ -0,0 +1,256 @@
+/*
+ * This is a free software and provides no guarantee of any kind.
+ * The distribution and changes to the software is as provided by the LICENSE.
+ * View the LICENSE file in github.com/sumefsp/LPM-Algorithms-Linux-XIA and
+ * any usage of code from this file must include this declaration.
+ *
+ * 2015, LPM Algorithms for Linux XIA
+ * Garnaik Sumeet, Michel Machado
+ *
+ * XID primitives shared by all the LPM engines.
+ *
+ * An XID is stored in memory as 20 big-endian bytes (struct xid) so that it
+ * can be copied straight out of the FIB tables. Every bit operation loads the
+ * XID into three native words (struct xid_words), works on whole words without
+ * branching on the shift amount and stores the result back.
+ */
+#ifndef _XID_KERNEL_H_
+#define _XID_KERNEL_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
+
+#define XID_BITS 160	/* the number of bits in an XID */
+#define XID_BYTES 20	/* the number of bytes in an XID */
+
+typedef struct xid { unsigned char w[XID_BYTES]; } xid;
+
+/*
+ * An XID as native words: hi holds bits 0-63, mid bits 64-127 and lo bits
+ * 128-159, where bit 0 is the most significant bit of the XID.
+ */
+struct xid_words {
+	uint64_t hi;
+	uint64_t mid;
+	uint32_t lo;
+};
+
+/*
+ * Load the 20 big-endian bytes of id into native words
+ */
+static inline void xid_load(struct xid_words *x, const xid *id)
+{
+	uint64_t hi, mid;
+	uint32_t lo;
+
+	memcpy(&hi, id->w, 8);
+	memcpy(&mid, id->w + 8, 8);
+	memcpy(&lo, id->w + 16, 4);
+	x->hi = be64toh(hi);
+	x->mid = be64toh(mid);
+	x->lo = be32toh(lo);
+}
+
+/*
+ * Store native words back as the 20 big-endian bytes of id
+ */
+static inline void xid_store(xid *id, const struct xid_words *x)
+{
+	uint64_t hi = htobe64(x->hi);
+	uint64_t mid = htobe64(x->mid);
+	uint32_t lo = htobe32(x->lo);
+
+	memcpy(id->w, &hi, 8);
+	memcpy(id->w + 8, &mid, 8);
+	memcpy(id->w + 16, &lo, 4);
+}
+
+/*
+ * (h:l << s) keeping the upper word, valid for s in [0, 63] without a branch
+ * on s == 0.
+ */
+static inline uint64_t _xid_funnel_left(uint64_t h, uint64_t l,
+		unsigned int s)
+{
+	return (h << s) | ((l >> 1) >> (63 - s));
+}
+
+/*
+ * (h:l >> s) keeping the lower word, valid for s in [0, 63].
+ */
+static inline uint64_t _xid_funnel_right(uint64_t h, uint64_t l,
+		unsigned int s)
+{
+	return (l >> s) | ((h << 1) << (63 - s));
+}
+
+/*
+ * A word with its n most significant bits set, valid for n in [0, 64].
+ */
+static inline uint64_t _xid_topmask(unsigned int n)
+{
+	return -(uint64_t) (n != 0) << ((64 - n) & 63);
+}
+
+/*
+ * Clamp the number of bits of the mask that fall in the word starting at bit
+ * `start` of the XID to [0, 64].
+ */
+static inline unsigned int _xid_lanebits(int len, int start)
+{
+	int n = len - start;
+
+	n = n < 0 ? 0 : n;
+	return n > 64 ? 64 : n;
+}
+
+/*
+ * Bitwise shift left x by shift bits. Shifts of XID_BITS or more clear x.
+ *
+ * The XID is handled as three 64-bit lanes with lo in the upper half of the
+ * third lane, so the bits below bit 160 are always zero and a shift is two
+ * table reads and a funnel per lane.
+ */
+static inline void xidw_shl(struct xid_words *x, unsigned int shift)
+{
+	uint64_t v[6] = {x->hi, x->mid, (uint64_t) x->lo << 32, 0, 0, 0};
+	unsigned int q, r;
+
+	shift = shift > XID_BITS ? XID_BITS : shift;
+	q = shift >> 6;
+	r = shift & 63;
+	x->hi = _xid_funnel_left(v[q], v[q + 1], r);
+	x->mid = _xid_funnel_left(v[q + 1], v[q + 2], r);
+	x->lo = _xid_funnel_left(v[q + 2], v[q + 3], r) >> 32;
+}
+
+/*
+ * Bitwise shift right x by shift bits. Shifts of XID_BITS or more clear x.
+ */
+static inline void xidw_shr(struct xid_words *x, unsigned int shift)
+{
+	uint64_t v[6] = {0, 0, 0, x->hi, x->mid, (uint64_t) x->lo << 32};
+	unsigned int q, r;
+
+	shift = shift > XID_BITS ? XID_BITS : shift;
+	q = shift >> 6;
+	r = shift & 63;
+	x->hi = _xid_funnel_right(v[2 - q], v[3 - q], r);
+	x->mid = _xid_funnel_right(v[3 - q], v[4 - q], r);
+	x->lo = _xid_funnel_right(v[4 - q], v[5 - q], r) >> 32;
+}
+
+/*
+ * Keep the len most significant bits of x and clear the rest.
+ */
+static inline void xidw_mask(struct xid_words *x, int len)
+{
+	x->hi &= _xid_topmask(_xid_lanebits(len, 0));
+	x->mid &= _xid_topmask(_xid_lanebits(len, 64));
+	x->lo &= _xid_topmask(_xid_lanebits(len, 128)) >> 32;
+}
+
+/*
+ * Clear the "bits" most significant bits of x.
+ */
+static inline void xidw_unmask(struct xid_words *x, int bits)
+{
+	x->hi &= ~_xid_topmask(_xid_lanebits(bits, 0));
+	x->mid &= ~_xid_topmask(_xid_lanebits(bits, 64));
+	x->lo &= ~(_xid_topmask(_xid_lanebits(bits, 128)) >> 32);
+}
+
+/*
+ * Return the len bits of id starting at bit pos as an integer, i.e. the same
+ * value as xidtounsigned(extract(pos, len, *id)) without building any XID.
+ *
+ * A single unaligned big-endian 64-bit window that covers the field is read
+ * and shifted. len must be in [0, 32] and pos in [0, 159]; bits past the end
+ * of the XID read as zero.
+ */
+static inline uint32_t xid_bits_u32(const xid *id, int pos, int len)
+{
+	int off = pos >> 3;
+	uint64_t v;
+
+	off = off > XID_BYTES - 8 ? XID_BYTES - 8 : off;
+	memcpy(&v, id->w + off, 8);
+	v = be64toh(v) << (pos - (off << 3));
+	return (v >> (63 - len)) >> 1;
+}
+
+/*
+ * Return the length of the longest common prefix of a and b in bits, which is
+ * XID_BITS when they are equal. b matches a prefix of length len of a if and
+ * only if xid_lcp(a, b) >= len.
+ */
+static inline int xid_lcp(const xid *a, const xid *b)
+{
+	struct xid_words x, y;
+	uint64_t diff;
+
+	xid_load(&x, a);
+	xid_load(&y, b);
+	if ((diff = x.hi ^ y.hi))
+		return __builtin_clzll(diff);
+	if ((diff = x.mid ^ y.mid))
+		return 64 + __builtin_clzll(diff);
+	if ((diff = (uint64_t) (x.lo ^ y.lo) << 32))
+		return 128 + __builtin_clzll(diff);
+	return XID_BITS;
+}
+
+/*
+ * A set of prefix lengths in [0, XID_BITS], with length len at bit len % 64 of
+ * word len / 64. Every base entry of a trie keeps the lengths of the prefixes
+ * of its XID so that the longest one it shares with a looked up XID is found
+ * without walking a chain of prefixes.
+ */
+#define XID_LENMAP_WORDS 3
+
+static inline void xid_lenmap_set(uint64_t *map, int len)
+{
+	map[len >> 6] |= (uint64_t) 1 << (len & 63);
+}
+
+/*
+ * Return the number of lengths of map that are not longer than lcp, so the
+ * longest prefix of length at most lcp is entry rank - 1 of an array that
+ * holds one entry per length of map in increasing order, and there is none if
+ * rank is 0.
+ */
+static inline int xid_lenmap_rank(const uint64_t *map, int lcp)
+{
+	int w = lcp >> 6, i, rank = 0;
+
+	for (i = 0; i < w; i++)
+		rank += __builtin_popcountll(map[i]);
+	return rank + __builtin_popcountll(map[w] &
+			(~(uint64_t) 0 >> (63 - (lcp & 63))));
+}
+
+/* In xid_kernel.c */
+
+/* Bitwise shifting operations on xids*/
+xid shift_left(xid id, int shift);
+xid shift_right(xid id, int shift);
+
+/* Extract operation for xids*/
+xid extract(int pos, int length, xid data);
+
+/* Remove bits from xids*/
+xid removexid(int bits, xid data);
+
+/*
+ * Compare XIDs and return 0, 1, -1 depending on the values pointed by
+ * dereferencing id1 and id2 twice.
+ */
+int comparexid(const void *id1, const void *id2);
+
+/*
+ * Extract the 32 LSBs and cast to uint32_t
+ */
+uint32_t xidtounsigned(xid *bitpat);
+
+#endif
@@ -1,8 +1,14 @@
 #!/bin/bash
 
 gcc -c -I ./dSFMT-src-2.2.1/ -I ./Data-Generation/ -I ./Bloom-Filter/ -I ./Radix-Trie/ -O3 -funroll-loops evaluate_correctness.c rdist.c
-gcc -c -I ./dSFMT-src-2.2.1/ -I ./Data-Generation/ -I ./Bloom-Filter/ -I ./Radix-Trie/ -O3 -funroll-loops ./Data-Generation/*.c ./Bloom-Filter/*.c ./Radix-Trie/*.c ./dSFMT-src-2.2.1/*.c
-gcc -o test *.o /usr/local/lib/libhashit.so.1.0 -lgsl -lgslcblas -lm -lrt -O3 -funroll-loops
+gcc -c -I ./dSFMT-src-2.2.1/ -I ./Data-Generation/ -I ./Bloom-Filter/ -I ./Radix-Trie/ -O3 -funroll-loops ./Data-Generation/*.c ./Bloom-Filter/*.c ./Radix-Trie/*.c ./XID-Kernel/*.c ./dSFMT-src-2.2.1/*.c
+gcc -o test *.o -lgsl -lgslcblas -lm -lrt -pthread -O3 -funroll-loops
+rm *.o
+./test
+rm test
+gcc -c -DLCTRIE -I ./dSFMT-src-2.2.1/ -I ./Data-Generation/ -I ./LC-Trie/ -O3 -funroll-loops evaluate_correctness.c rdist.c
+gcc -c -I ./dSFMT-src-2.2.1/ -I ./Data-Generation/ -I ./LC-Trie/ -O3 -funroll-loops ./Data-Generation/*.c ./LC-Trie/*.c ./XID-Kernel/*.c ./dSFMT-src-2.2.1/*.c
+gcc -o test *.o -lgsl -lgslcblas -lm -lrt -pthread -O3 -funroll-loops
 rm *.o
 ./test
 rm test
@@ -1,10 +1,19 @@
 #include "generate_fibs.h"
+#if defined(LCTRIE)
+#include "lpm_lctrie.h"
+#elif defined(RADIXLAYOUT)
+#include "lpm_radix.h"
+#elif defined(BLOOMHASH)
+#include "lpm_bloom.h"
+#else
 #include "lpm_bloom.h"
 #include "lpm_radix.h"
+#endif
 #include <fcntl.h>
 #include <time.h>
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/wait.h>
 #include "rdist.h"
 
 #define LEXPFIB 4
@@ -18,8 +27,14 @@
 #define LOOPSEED ((RUNS) * ((NEXTSEED) + SEED_UINT32_N))
 #define LOOKUPFILEBLOOM "bloom_lookup_measurements"
 #define LOOKUPFILERADIX "radix_lookup_measurements"
+#define LOOKUPFILERADIXMB "radixmb_lookup_measurements"
+#define LOOKUPFILERADIXLP "radixlp_lookup_measurements"
+#define LOOKUPFILEBLOOMBS "bloombs_lookup_measurements"
 #define NEXTHOPSFILERADIX "radix_nexthops_measurements"
 #define NEXTHOPSFILEBLOOM "bloom_nexthops_measurements"
+#define SHAPEFILELCTRIE "lctrie_shape_measurements"
+#define LAYOUTFILERADIX "radix_layout_measurements"
+#define HASHFILEBLOOM "bloom_hash_measurements"
 
 
 static unsigned long sampleindex(struct zipf_cache *zcache)
@@ -46,6 +61,243 @@ static int time_measure(struct timespec *ntime)
 	return 0;
 }
 
+/*
+ * Run experiment RUNS times on tables of 2^exp routes, each run in a child
+ * process with a table drawn from the seeds from low, and report every run
+ * as done with the experiments of kind on engine
+ */
+static int run_experiments(int exp, uint32_t *seeds, int low, int seedsize,
+		int nnexthops, double alpha,
+		int (*experiment)(const void *, const void *, const void *,
+			const void *), const char *kind, const char *engine)
+{
+	int j;
+	pid_t id;
+	unsigned long size = 1 << exp;
+	struct nextcreate *table = NULL;
+
+	for (j = 0; j < RUNS; j++) {
+		id = fork();
+		assert(id >= 0);
+		if (0 == id) {
+			table = malloc(sizeof(struct nextcreate) * size);
+			assert(0 == table_dist(exp, seeds, low, table, seedsize, nnexthops, alpha));
+			low = low + NEXTSEED;
+			assert(low < seedsize);
+			assert(0 == experiment(table, &size, &seeds[low], &alpha));
+			free(table);
+			exit(EXIT_SUCCESS);
+		} else {
+			assert(wait(NULL) >= 0);
+			low = low + NEXTSEED + SEED_UINT32_N;
+			assert(low < seedsize);
+			printf("Done %s experiments %s 2^%d with run: %d\n", kind, engine, exp, j);
+		}
+	}
+	return 0;
+}
+
+#if defined(LCTRIE)
+/*
+ * Build the LC-Trie of a table with opts and record the average and maximum
+ * lookup depth against the memory taken by the trie, along with the time of
+ * NLOOKUPS lookups. The same lookups are then timed as a whole, once with
+ * lctrie_lookup() in a loop and once with lctrie_lookup_batch(), which leaves
+ * out the clock reads of every lookup. ids and nexthops hold NLOOKUPS entries.
+ */
+static void shape_lctrie(struct nextcreate *table, unsigned long size,
+		uint32_t *seed, double alpha,
+		const struct lctrie_build_opts *opts, xid *ids,
+		unsigned int *nexthops)
+{
+	struct timespec start, stop;
+	struct lctrie_stat st;
+	struct routtablerec *fib;
+	struct zipf_cache zcache;
+	xid *id = NULL;
+	FILE *fp = NULL;
+	unsigned long tmp;
+	unsigned long accum, loop, batch;
+	int k;
+
+	fib = lctrie_create_fib_opts(table, size, opts);
+	assert(0 == lctrie_stat(fib, &st));
+	// Every configuration looks up the same sequence of XIDs
+	init_zipf_cache(&zcache, size * 30, alpha, size, seed, SEED_UINT32_N);
+	accum = 0;
+	for (k = 0; k < NLOOKUPS; k++) {
+		tmp = sampleindex(&zcache) % size;
+		id = (xid *) &(table[tmp].prefix);
+		ids[k] = *id;
+		time_measure(&start);
+		lctrie_lookup(id, fib);
+		time_measure(&stop);
+		accum += gettime(&start, &stop);
+	}
+	end_zipf_cache(&zcache);
+	time_measure(&start);
+	for (k = 0; k < NLOOKUPS; k++)
+		nexthops[k] = lctrie_lookup(&ids[k], fib);
+	time_measure(&stop);
+	loop = gettime(&start, &stop);
+	time_measure(&start);
+	lctrie_lookup_batch(ids, NLOOKUPS, nexthops, fib);
+	time_measure(&stop);
+	batch = gettime(&start, &stop);
+	fp = fopen(SHAPEFILELCTRIE, "a");
+	fprintf(fp, "%lu\t%.2f\t%d\t%d\t%.4f\t%d\t%lu\t%lu\t%lu\t%lu\t%lu\n",
+		size, opts->fillfactor, opts->rootbranch, opts->dirbits,
+		st.avgdepth, st.maxdepth, st.triebytes, st.bytes, accum, loop,
+		batch);
+	fclose(fp);
+	lctrie_destroy_fib(fib);
+}
+
+/*
+ * Run shape_lctrie() on a table for every fill factor, root branch and size
+ * of the direct-index front table in the sweep
+ */
+static int evaluate_shape_lctrie(const void *t, const void *ts,
+		const void *s, const void *al)
+{
+	struct nextcreate *table = (struct nextcreate *) t;
+	unsigned long *size = (unsigned long *) ts;
+	uint32_t *seed = (uint32_t *) s;
+	double *alpha = (double *) al;
+	const double fillfactors[] = {1.0, 0.75, 0.5, 0.25};
+	const int rootbranches[] = {0, 8, 12, 16};
+	const int dirbits[] = {0, 8, 12, 16};
+	struct lctrie_build_opts opts;
+	xid *ids = malloc(sizeof(xid) * NLOOKUPS);
+	unsigned int *nexthops = malloc(sizeof(unsigned int) * NLOOKUPS);
+	int i, j, k;
+
+	setpriority(PRIO_PROCESS, 0, -20);
+	opts.maxbranch = LCTRIE_MAXBRANCH;
+	opts.nthreads = LCTRIE_NTHREADS;
+	for (i = 0; i < sizeof(fillfactors) / sizeof(fillfactors[0]); i++) {
+		opts.fillfactor = fillfactors[i];
+		for (j = 0; j < sizeof(rootbranches) / sizeof(rootbranches[0]);
+				j++) {
+			opts.rootbranch = rootbranches[j];
+			for (k = 0; k < sizeof(dirbits) / sizeof(dirbits[0]);
+					k++) {
+				opts.dirbits = dirbits[k];
+				shape_lctrie(table, *size, seed, *alpha, &opts,
+						ids, nexthops);
+			}
+		}
+	}
+	free(nexthops);
+	free(ids);
+	return 0;
+}
+
+#elif defined(RADIXLAYOUT)
+/*
+ * Build the Radix trie of a table, move its nodes into every layout in turn
+ * and record the time of the same NLOOKUPS lookups in each of them.
+ */
+static int evaluate_layout_radix(const void *t, const void *ts,
+		const void *s, const void *al)
+{
+	struct timespec start, stop;
+	struct nextcreate *table = (struct nextcreate *) t;
+	unsigned long *size = (unsigned long *) ts;
+	uint32_t *seed = (uint32_t *) s;
+	double *alpha = (double *) al;
+	const int layouts[] = {RADIX_LAYOUT_DFS, RADIX_LAYOUT_BFS,
+		RADIX_LAYOUT_VEB};
+	struct routtablerec *fib;
+	xid *id = NULL;
+	FILE *fp = NULL;
+	unsigned long tmp;
+	unsigned long accum;
+	int i, k;
+
+	setpriority(PRIO_PROCESS, 0, -20);
+	fib = radix_create_fib(table, *size);
+	for (i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+		struct zipf_cache zcache;
+
+		assert(0 == radix_layout(fib, layouts[i]));
+		// Every layout looks up the same sequence of XIDs
+		init_zipf_cache(&zcache, *size * 30, *alpha, *size, seed,
+				SEED_UINT32_N);
+		accum = 0;
+		for (k = 0; k < NLOOKUPS; k++) {
+			tmp = sampleindex(&zcache) % *size;
+			id = (xid *) &(table[tmp].prefix);
+			time_measure(&start);
+			lookup_radix(id, fib, 0);
+			time_measure(&stop);
+			accum += gettime(&start, &stop);
+		}
+		end_zipf_cache(&zcache);
+		fp = fopen(LAYOUTFILERADIX, "a");
+		fprintf(fp, "%lu\t%d\t%lu\n", *size, layouts[i], accum);
+		fclose(fp);
+	}
+	radix_destroy_fib(fib);
+	return 0;
+}
+
+#elif defined(BLOOMHASH)
+/*
+ * Build the Bloom structure of a table with every hash function this host
+ * supports and record the time of the same NLOOKUPS lookups in each of them,
+ * along with the probes of the filters and their false positives.
+ */
+static int evaluate_hash_bloom(const void *t, const void *ts,
+		const void *s, const void *al)
+{
+	struct timespec start, stop;
+	struct nextcreate *table = (struct nextcreate *) t;
+	unsigned long *size = (unsigned long *) ts;
+	uint32_t *seed = (uint32_t *) s;
+	double *alpha = (double *) al;
+	struct bloom_structure *filter;
+	struct bloom_stat st;
+	unsigned char (*id)[HEXXID] = NULL;
+	FILE *fp = NULL;
+	unsigned long tmp;
+	unsigned long accum;
+	int hash, k;
+
+	setpriority(PRIO_PROCESS, 0, -20);
+	for (hash = 0; hash < BLOOM_NHASHES; hash++) {
+		struct zipf_cache zcache;
+
+		if (!bloom_hash_supported(hash))
+			continue;
+		filter = bloom_create_fib_hash(table, *size, BLOOMERRORRATE,
+				hash);
+		assert(filter);
+		// Every hash function looks up the same sequence of XIDs
+		init_zipf_cache(&zcache, *size * 30, *alpha, *size, seed,
+				SEED_UINT32_N);
+		accum = 0;
+		memset(&st, 0, sizeof(st));
+		for (k = 0; k < NLOOKUPS; k++) {
+			tmp = sampleindex(&zcache) % *size;
+			id = (unsigned char (*)[HEXXID]) &(table[tmp].prefix);
+			time_measure(&start);
+			lookup_bloom(id, table[tmp].len, filter);
+			time_measure(&stop);
+			accum += gettime(&start, &stop);
+			bloom_lookup_stat(id, filter, &st);
+		}
+		end_zipf_cache(&zcache);
+		fp = fopen(HASHFILEBLOOM, "a");
+		fprintf(fp, "%lu\t%d\t%lu\t%lu\t%lu\t%lu\n", *size, hash,
+			accum, st.probes, st.positives, st.false_positives);
+		fclose(fp);
+		bloom_destroy_fib(filter);
+	}
+	return 0;
+}
+
+#else
 static int evaluate_nexthops_radix(const void *t, const void *ts,
 		const void *nh, const void *s, const void *al)
 {
@@ -175,14 +427,17 @@ static int nexthops_experiments(int exp, uint32_t *seeds, int low,
 	return 0;
 }
 
-static int evaluate_lookups_radix(const void *t, const void *ts,
-		const void *s, const void *al)
+/*
+ * Record in file the time of NLOOKUPS lookups of the XIDs of a table in fib, a
+ * Radix trie variant of the table searched with the given lookup function
+ */
+static int lookups_radix(const void *t, const void *ts, const void *s,
+		const void *al, void *fib,
+		unsigned int (*lookup)(const xid *, void *), const char *file)
 {
 	struct timespec start, stop;
 	struct nextcreate *table = (struct nextcreate *) t;
 	unsigned long *size = (unsigned long *) ts;
-	struct nextcreate *tmp_table = malloc(sizeof(struct nextcreate) * *size);
-	memcpy(tmp_table, table, sizeof(struct nextcreate) * *size);
 	uint32_t *seed = (uint32_t *) s;
 	double *alpha = (double *) al;
 	FILE *fp = NULL;
@@ -191,32 +446,83 @@ static int evaluate_lookups_radix(const void *t, const void *ts,
 	int i;
 	xid *id = NULL;
 	struct zipf_cache zcache;
-	int wrong = 0;
 
 	init_zipf_cache(&zcache, *size * 30, *alpha, *size, seed, SEED_UINT32_N);
 	setpriority(PRIO_PROCESS, 0, -20);
-	// Create the data structure
-	struct routtablerec *fib = radix_create_fib(table, *size);
 	for (i = 0; i < NLOOKUPS; i++) {
 		tmp = sampleindex(&zcache) % *size;
-		id = (xid *) &(tmp_table[tmp].prefix);
-		// Sample from table and set the XID in appropriate form
+		id = (xid *) &(table[tmp].prefix);
 		time_measure(&start);
-		lookup_radix(id, fib, 0);
+		lookup(id, fib);
 		time_measure(&stop);
 		accum += gettime(&start, &stop);
 	}
 	end_zipf_cache(&zcache);
-	fp = fopen(LOOKUPFILERADIX, "a");
+	fp = fopen(file, "a");
 	fprintf(fp, "%lu\t%lu\n", *size, accum);
 	fclose(fp);
+	return 0;
+}
+
+static unsigned int radix_lookup(const xid *id, void *fib)
+{
+	return lookup_radix(id, (struct routtablerec *) fib, 0);
+}
+
+static unsigned int radix_mb_lookup(const xid *id, void *fib)
+{
+	return lookup_radix_mb(id, (struct radix_mbtable *) fib, 0);
+}
+
+static unsigned int radix_lp_lookup(const xid *id, void *fib)
+{
+	return lookup_radix_lp(id, (struct radix_lptable *) fib, 0);
+}
+
+static int evaluate_lookups_radix(const void *t, const void *ts,
+		const void *s, const void *al)
+{
+	struct routtablerec *fib = radix_create_fib((struct nextcreate *) t,
+			*(unsigned long *) ts);
+
+	assert(0 == lookups_radix(t, ts, s, al, fib, radix_lookup,
+				LOOKUPFILERADIX));
 	radix_destroy_fib(fib);
-	free(tmp_table);
 	return 0;
 }
 
-static int evaluate_lookups_bloom(const void *t, const void *ts,
+static int evaluate_lookups_radix_mb(const void *t, const void *ts,
+		const void *s, const void *al)
+{
+	struct radix_mbtable *fib = radix_mb_create_fib((struct nextcreate *) t,
+			*(unsigned long *) ts, RADIX_STRIDE);
+
+	assert(0 == lookups_radix(t, ts, s, al, fib, radix_mb_lookup,
+				LOOKUPFILERADIXMB));
+	radix_mb_destroy_fib(fib);
+	return 0;
+}
+
+static int evaluate_lookups_radix_lp(const void *t, const void *ts,
 		const void *s, const void *al)
+{
+	struct radix_lptable *fib = radix_lp_create_fib((struct nextcreate *) t,
+			*(unsigned long *) ts);
+
+	assert(0 == lookups_radix(t, ts, s, al, fib, radix_lp_lookup,
+				LOOKUPFILERADIXLP));
+	radix_lp_destroy_fib(fib);
+	return 0;
+}
+
+/*
+ * Record in file the time of NLOOKUPS lookups of the Bloom filter FIB of a
+ * table with the given lookup function, with the tables of the binary search
+ * built first if bsearch is set
+ */
+static int lookups_bloom(const void *t, const void *ts, const void *s,
+		const void *al, unsigned int (*lookup)(unsigned char (*)[HEXXID],
+			unsigned int, void *), int bsearch, const char *file)
 {
 	struct timespec start, stop;
 	struct nextcreate *table = (struct nextcreate *) t;
@@ -231,73 +537,68 @@ static int evaluate_lookups_bloom(const void *t, const void *ts,
 	unsigned int len;
 	unsigned long accum = 0;
 	struct zipf_cache zcache;
-	int wrong = 0;
 
 	init_zipf_cache(&zcache, *size * 30, *alpha, *size, seed, SEED_UINT32_N);
 	setpriority(PRIO_PROCESS, 0, -20);
 	// Create the data structure
 	struct bloom_structure *filter = bloom_create_fib(table, *size, error_rate);
+	if (bsearch)
+		assert(0 == bloom_bsearch_build(filter));
 	for (i = 0; i < NLOOKUPS; i++) {
 		tmp = sampleindex(&zcache) % *size;
 		memcpy(id, table[tmp].prefix, HEXXID);
 		len = table[tmp].len;
 		time_measure(&start);
-		lookup_bloom(&id[0], len, filter);
+		lookup(&id[0], len, filter);
 		time_measure(&stop);
 		accum += gettime(&start, &stop);
 	}
 	free(id);
 	end_zipf_cache(&zcache);
-	fp = fopen(LOOKUPFILEBLOOM, "a");
+	fp = fopen(file, "a");
 	fprintf(fp, "%lu\t%lu\n", *size, accum);
 	fclose(fp);
 	bloom_destroy_fib(filter);
 	return 0;
 }
 
+static int evaluate_lookups_bloom(const void *t, const void *ts,
+		const void *s, const void *al)
+{
+	return lookups_bloom(t, ts, s, al, lookup_bloom, 0, LOOKUPFILEBLOOM);
+}
+
+static int evaluate_lookups_bloom_bsearch(const void *t, const void *ts,
+		const void *s, const void *al)
+{
+	return lookups_bloom(t, ts, s, al, lookup_bloom_bsearch, 1,
+			LOOKUPFILEBLOOMBS);
+}
+
 static int lookup_experiments(int exp, uint32_t *seeds, int low, int seedsize,
 		int nnexthops, double alpha)
 {
-	int i, j;
-	pid_t id;
-	unsigned long size = 1 << exp;
-	struct nextcreate *table = NULL;
-	int o_seed = low;
+	int i;
 	int (*experiments[])(const void *, const void *, const void *,
 						const void *) = {
 		evaluate_lookups_bloom,
 		evaluate_lookups_radix,
+		evaluate_lookups_radix_mb,
+		evaluate_lookups_radix_lp,
+		evaluate_lookups_bloom_bsearch,
 		NULL,
 	};
+	const char *names[] = {"bloom", "radix", "radix multibit",
+		"radix leaf-pushed", "bloom binary search"};
 
-	for (i = 0; experiments[i] != NULL;  i++) {
-		low = o_seed;
-		for (j = 0; j < RUNS; j++) {
-			id = fork();
-			assert(id >= 0);
-			if (0 == id) {
-				table = malloc(sizeof(struct nextcreate) *
-						size);
-				assert(0 == table_dist(exp, seeds, low, table, seedsize, nnexthops, alpha));
-				low = low + NEXTSEED;
-				assert(low < seedsize);
-				assert(0 == (experiments[i])
-					(table, &size, &seeds[low], &alpha));
-				free(table);
-				exit(EXIT_SUCCESS);
-			} else {
-				assert(wait(NULL) >= 0);
-				low = low + NEXTSEED + SEED_UINT32_N;
-				assert(low < seedsize);
-				if (0 == i)
-					printf("Done lookup experiments bloom 2^%d with run: %d\n", exp, j);
-				else
-					printf("Done lookup experiments radix 2^%d with run: %d\n", exp, j);
-			}
-		}
-	}
+	// Every engine looks up the same tables
+	for (i = 0; experiments[i] != NULL;  i++)
+		assert(0 == run_experiments(exp, seeds, low, seedsize,
+					nnexthops, alpha, experiments[i],
+					"lookup", names[i]));
 	return 0;
 }
+#endif
 
 int main(int argc, char *argv[])
 {
@@ -326,12 +627,29 @@ int main(int argc, char *argv[])
 		// This is taken as a constant for the number of 
 		nnexthops = 16;
 		alpha = 1.0;
+#if defined(LCTRIE)
+		assert(0 == run_experiments(i, seeds, low, seedsize,
+					nnexthops, alpha, evaluate_shape_lctrie,
+					"shape", "lctrie"));
+		printf("Done shape experiment 2^%d\n", i);
+#elif defined(RADIXLAYOUT)
+		assert(0 == run_experiments(i, seeds, low, seedsize,
+					nnexthops, alpha, evaluate_layout_radix,
+					"layout", "radix"));
+		printf("Done layout experiment 2^%d\n", i);
+#elif defined(BLOOMHASH)
+		assert(0 == run_experiments(i, seeds, low, seedsize,
+					nnexthops, alpha, evaluate_hash_bloom,
+					"hash", "bloom"));
+		printf("Done hash experiment 2^%d\n", i);
+#else
 		assert(0 == lookup_experiments(i, seeds, low, seedsize,
 					nnexthops, alpha));
 		printf("Done lookup experiment 2^%d\n", i);
 		assert(0 ==
 			nexthops_experiments(i, seeds, low, seedsize, alpha));
 		printf("Done nexthop experiment 2^%d\n", i);
+#endif
 		low = low + LOOPSEED;
 		assert(low < seedsize);
 	}
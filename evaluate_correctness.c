@@ -1,11 +1,35 @@
 #include "generate_fibs.h"
+#if defined(LCTRIE)
+#include "lpm_lctrie.h"
+#else
 #include "lpm_bloom.h"
 #include "lpm_radix.h"
+#endif
 #include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #define LEXPFIB 4
 #define HEXPFIB 20
 #define BLOOMERRORRATE 0.05
+#define NSTRIDES 3
+#define NREADERS 4
+#define QUERYSEED NEXTSEED	/* seed of the random XIDs, after the table's */
+#define PERTURBSEED (QUERYSEED + 1)	/* seed of the bits flipped in routes */
+#define BRUTEWORK (1 << 24)	/* routes checked by brute force per table */
+#define LCTRIEROOTBITS 8
+#define LCTRIESINGLES 512
+#define LCTRIEIMAGEVERSION 8	/* offset of the version in a saved LC-Trie */
+#define NDIRBITS 4
+
+#if defined(LCTRIE)
+/* Bits of the direct-index front tables of the LC-Tries checked, 0 for none */
+static const int dirbits[NDIRBITS] = {0, 8, 12, 16};
+#else
+/* Strides of the multibit Radix tries checked, from 1 to MAXSTRIDE */
+static const int strides[NSTRIDES] = {1, 5, RADIX_STRIDE};
+#endif
 
 static int sortentries(const void *e1, const void *e2)
 {
@@ -25,18 +49,413 @@ static int sortentries(const void *e1, const void *e2)
 		return 0;
 }
 
+/* Fill ids[0..n-1] with random XIDs, which are almost never routes */
+static void randomxids(uint32_t seed, xid *ids, unsigned long n)
+{
+	gsl_rng *r = gsl_rng_alloc(gsl_rng_ranlux);
+	unsigned char *id = (unsigned char *) ids;
+	unsigned long i;
+
+	gsl_rng_set(r, seed);
+	for (i = 0; i < n * sizeof(xid); i++)
+		id[i] = gsl_rng_uniform_int(r, 1 << BYTE);
+	gsl_rng_free(r);
+}
+
+#if defined(LCTRIE)
+/*
+ * Create an updatable LC-Trie with the first half of the routes, insert the
+ * second half and delete every other route of it, the first LCTRIESINGLES of
+ * each one at a time and the others in one batch, then compare the lookups of
+ * all the routes with an LC-Trie built from the routes left
+ */
+static int lctrie_update_experiment(struct nextcreate *table,
+		unsigned long size)
+{
+	unsigned long j, half = size / 2, nleft = half;
+	int n = 0;
+	struct nextcreate *left = malloc(sizeof(struct nextcreate) * size);
+	struct lctrie_update *u = malloc(sizeof(struct lctrie_update) * size);
+	xid *id = alloca(sizeof(xid));
+	struct lctrie_dyntable *dyn = lctrie_dyn_create(table, half,
+			LCTRIEROOTBITS, NULL);
+	struct routtablerec *fib;
+
+	for (j = half; j < size; j++) {
+		memcpy(id, table[j].prefix, HEXXID);
+		if (j < half + LCTRIESINGLES) {
+			assert(1 == lctrie_insert(dyn, id, table[j].len,
+						table[j].nexthop));
+			continue;
+		}
+		u[n].op = LCTRIE_INSERT;
+		u[n].prefix = *id;
+		u[n].len = table[j].len;
+		u[n].nexthop = table[j].nexthop;
+		n++;
+	}
+	assert(n == lctrie_apply_updates(dyn, u, n));
+	n = 0;
+	for (j = half + 1; j < size; j += 2) {
+		memcpy(id, table[j].prefix, HEXXID);
+		if (j < half + LCTRIESINGLES) {
+			assert(1 == lctrie_delete(dyn, id, table[j].len));
+			continue;
+		}
+		u[n].op = LCTRIE_DELETE;
+		u[n].prefix = *id;
+		u[n].len = table[j].len;
+		n++;
+	}
+	assert(n == lctrie_apply_updates(dyn, u, n));
+	assert(0 == lctrie_dyn_reclaim(dyn));
+
+	memcpy(left, table, sizeof(struct nextcreate) * half);
+	for (j = half; j < size; j += 2)
+		left[nleft++] = table[j];
+	fib = lctrie_create_fib(left, nleft);
+	for (j = 0; j < size; j++) {
+		memcpy(id, table[j].prefix, HEXXID);
+		assert(lctrie_dyn_lookup(id, dyn) == lctrie_lookup(id, fib));
+	}
+	lctrie_destroy_fib(fib);
+	lctrie_dyn_destroy(dyn);
+	free(u);
+	free(left);
+	return 0;
+}
+
+/* Flip the bits of byte off of the file fd */
+static void flipbyte(int fd, off_t off)
+{
+	unsigned char byte;
+
+	assert(1 == pread(fd, &byte, 1, off));
+	byte = ~byte;
+	assert(1 == pwrite(fd, &byte, 1, off));
+}
+
+/*
+ * Save fib to a temporary file, map it and compare the lookups of
+ * ids[0..n-1] with fib, then check that the file is not mapped with a bad
+ * magic, a bad version or its last byte missing
+ */
+static int lctrie_image_experiment(struct routtablerec *fib, const xid *ids,
+		unsigned long n)
+{
+	char path[] = "/tmp/lctrieXXXXXX";
+	unsigned long j;
+	struct stat st;
+	struct routtablerec *image;
+	int fd = mkstemp(path);
+
+	assert(fd >= 0);
+	assert(0 == lctrie_save(fib, path));
+	image = lctrie_map(path);
+	assert(image);
+	for (j = 0; j < n; j++)
+		assert(lctrie_lookup(&ids[j], image) ==
+				lctrie_lookup(&ids[j], fib));
+	lctrie_destroy_fib(image);
+
+	flipbyte(fd, 0);
+	assert(NULL == lctrie_map(path));
+	flipbyte(fd, 0);
+	flipbyte(fd, LCTRIEIMAGEVERSION);
+	assert(NULL == lctrie_map(path));
+	flipbyte(fd, LCTRIEIMAGEVERSION);
+	image = lctrie_map(path);
+	assert(image);
+	lctrie_destroy_fib(image);
+
+	assert(0 == fstat(fd, &st));
+	assert(0 == ftruncate(fd, st.st_size - 1));
+	assert(NULL == lctrie_map(path));
+	close(fd);
+	assert(0 == unlink(path));
+	return 0;
+}
+
+/*
+ * Look up ids[0..n-1] in fib with lctrie_lookup_batch(), the first one alone
+ * and the others in groups that end with a partial one, and compare them with
+ * lctrie_lookup() in fib and in ref, an LC-Trie of the same routes
+ */
+static int lctrie_batch_experiment(struct routtablerec *fib,
+		struct routtablerec *ref, const xid *ids, unsigned long n)
+{
+	unsigned long j;
+	unsigned int *nexthops = malloc(sizeof(unsigned int) * n);
+
+	lctrie_lookup_batch(ids, 1, nexthops, fib);
+	lctrie_lookup_batch(&ids[1], n - 1, &nexthops[1], fib);
+	for (j = 0; j < n; j++) {
+		assert(nexthops[j] == lctrie_lookup(&ids[j], fib));
+		assert(nexthops[j] == lctrie_lookup(&ids[j], ref));
+	}
+	free(nexthops);
+	return 0;
+}
+
 static int correctness_experiment(int exp, uint32_t *seeds, int low,
 							int seedsize)
 {
 	int i;
-	unsigned long size = 1 << exp;
+	unsigned long j, size = 1 << exp;
+	struct nextcreate *table = NULL;
+	int nnexthops = 16;
+	struct lctrie_build_opts opts = {
+		.fillfactor = LCTRIE_FILLFACTOR,
+		.rootbranch = LCTRIE_ROOTBRANCH,
+		.maxbranch = LCTRIE_MAXBRANCH,
+		.nthreads = LCTRIE_NTHREADS,
+	};
+	xid *ids = malloc(sizeof(xid) * 2 * size);
+	struct routtablerec *ref, *fib;
+
+	table = malloc(sizeof(struct nextcreate) * size);
+	assert(0 == table_dist(exp, seeds, low, table, seedsize, nnexthops, 1.0));
+	// The routes followed by as many random XIDs
+	for (j = 0; j < size; j++)
+		memcpy(&ids[j], table[j].prefix, HEXXID);
+	randomxids(seeds[low + QUERYSEED], &ids[size], size);
+	ref = lctrie_create_fib(table, size);
+	for (i = 0; i < NDIRBITS; i++) {
+		opts.dirbits = dirbits[i];
+		fib = lctrie_create_fib_opts(table, size, &opts);
+		for (j = 0; j < size; j++)
+			assert(lctrie_lookup(&ids[j], fib) == table[j].nexthop);
+		assert(0 == lctrie_batch_experiment(fib, ref, ids, 2 * size));
+		assert(0 == lctrie_image_experiment(fib, ids, 2 * size));
+		lctrie_destroy_fib(fib);
+	}
+	lctrie_destroy_fib(ref);
+	assert(0 == lctrie_update_experiment(table, size));
+	free(ids);
+	free(table);
+
+	return 0;
+}
+
+#else
+/*
+ * Fill ids[0..size-1] with the routes of table, each with one random bit
+ * flipped, so that some fall under the route and some only under its prefixes
+ */
+static void perturbxids(uint32_t seed, const struct nextcreate *table,
+		unsigned long size, xid *ids)
+{
+	gsl_rng *r = gsl_rng_alloc(gsl_rng_ranlux);
+	unsigned char *id;
+	unsigned long i, bit;
+
+	gsl_rng_set(r, seed);
+	for (i = 0; i < size; i++) {
+		id = (unsigned char *) &ids[i];
+		memcpy(id, table[i].prefix, HEXXID);
+		bit = gsl_rng_uniform_int(r, HEXXID * BYTE);
+		id[bit / BYTE] ^= 0x80 >> (bit % BYTE);
+	}
+	gsl_rng_free(r);
+}
+
+/*
+ * Return the next-hop of the longest route of table that matches id, or 0 if
+ * none does
+ */
+static unsigned int bruteforce(const xid *id, const struct nextcreate *table,
+		unsigned long size)
+{
+	unsigned long i;
+	int best = -1;
+	unsigned int nexthop = 0;
+	xid route;
+
+	for (i = 0; i < size; i++) {
+		if ((int) table[i].len <= best)
+			continue;
+		memcpy(&route, table[i].prefix, HEXXID);
+		if (xid_lcp(&route, id) >= table[i].len) {
+			best = table[i].len;
+			nexthop = table[i].nexthop;
+		}
+	}
+	return nexthop;
+}
+
+/* A thread that looks up routes while the updatable Radix trie changes */
+struct radix_reader_arg {
+	struct radix_dyntable *fib;
+	struct nextcreate *table;	// Routes that no update touches
+	unsigned long size;
+	int *stop;
+	unsigned long wrong;
+};
+
+static void *radix_reader(void *arg)
+{
+	struct radix_reader_arg *r = (struct radix_reader_arg *) arg;
+	int reader = radix_dyn_reader(r->fib);
+	xid *id = alloca(sizeof(xid));
+	unsigned long i, j;
+
+	assert(reader >= 0);
+	// Every route is looked up at least once, however fast the updates are
+	for (i = 0; i < r->size || !__atomic_load_n(r->stop, __ATOMIC_ACQUIRE);
+			i++) {
+		j = i % r->size;
+		memcpy(id, r->table[j].prefix, HEXXID);
+		if (radix_dyn_lookup(id, r->fib, reader) != r->table[j].nexthop)
+			r->wrong++;
+	}
+	return NULL;
+}
+
+/*
+ * Create an updatable Radix trie with the first half of the routes, insert
+ * the second half and delete every other route of it while NREADERS threads
+ * look up the first half, then compare the lookups of all the routes with a
+ * Radix trie built from the routes left
+ */
+static int radix_update_experiment(struct nextcreate *table,
+		unsigned long size)
+{
+	int i, stop = 0, reader;
+	unsigned long j, half = size / 2, nleft = half;
+	struct nextcreate *left = malloc(sizeof(struct nextcreate) * size);
+	struct radix_reader_arg arg[NREADERS];
+	pthread_t thread[NREADERS];
+	xid *id = alloca(sizeof(xid));
+	struct radix_dyntable *dyn = radix_dyn_create(table, half, size);
+	struct routtablerec *fib;
+
+	for (i = 0; i < NREADERS; i++) {
+		arg[i].fib = dyn;
+		arg[i].table = table;
+		arg[i].size = half;
+		arg[i].stop = &stop;
+		arg[i].wrong = 0;
+		assert(0 == pthread_create(&thread[i], NULL, radix_reader,
+					&arg[i]));
+	}
+	for (j = half; j < size; j++) {
+		memcpy(id, table[j].prefix, HEXXID);
+		assert(1 == radix_insert(dyn, id, table[j].len,
+					table[j].nexthop));
+	}
+	for (j = half + 1; j < size; j += 2) {
+		memcpy(id, table[j].prefix, HEXXID);
+		assert(1 == radix_delete(dyn, id, table[j].len));
+	}
+	__atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+	for (i = 0; i < NREADERS; i++) {
+		assert(0 == pthread_join(thread[i], NULL));
+		assert(0 == arg[i].wrong);
+	}
+
+	memcpy(left, table, sizeof(struct nextcreate) * half);
+	for (j = half; j < size; j += 2)
+		left[nleft++] = table[j];
+	fib = radix_create_fib(left, nleft);
+	reader = radix_dyn_reader(dyn);
+	for (j = 0; j < size; j++) {
+		memcpy(id, table[j].prefix, HEXXID);
+		assert(radix_dyn_lookup(id, dyn, reader) ==
+				lookup_radix(id, fib, 0));
+	}
+	radix_destroy_fib(fib);
+	radix_dyn_destroy(dyn);
+	free(left);
+	return 0;
+}
+
+/*
+ * Add all the routes to a Bloom FIB that starts empty, delete every other one
+ * and compare the lookups of all the routes with a Radix trie of the routes
+ * left, then add the deleted routes back and check them with both lookups
+ */
+static int bloom_update_experiment(struct nextcreate *table,
+		unsigned long size)
+{
+	unsigned long i, nleft = 0;
+	struct nextcreate *left = malloc(sizeof(struct nextcreate) * size);
+	unsigned char (*id)[HEXXID] = calloc(HEXXID, sizeof(unsigned char));
+	struct bloom_structure *filter = bloom_create_fib(table, 0,
+			BLOOMERRORRATE);
+	struct routtablerec *fib;
+
+	assert(filter);
+	for (i = 0; i < size; i++)
+		assert(1 == bloom_route_add(filter, table[i].prefix,
+					table[i].len, table[i].nexthop));
+	for (i = 1; i < size; i += 2)
+		assert(1 == bloom_route_del(filter, table[i].prefix,
+					table[i].len));
+	for (i = 0; i < size; i += 2)
+		left[nleft++] = table[i];
+	fib = radix_create_fib(left, nleft);
+	for (i = 0; i < size; i++) {
+		memcpy(id, table[i].prefix, HEXXID);
+		assert(lookup_bloom(&id[0], table[i].len, filter) ==
+				lookup_radix((xid *) id, fib, 0));
+	}
+
+	for (i = 1; i < size; i += 2)
+		assert(1 == bloom_route_add(filter, table[i].prefix,
+					table[i].len, table[i].nexthop));
+	assert(0 == bloom_bsearch_build(filter));
+	for (i = 0; i < size; i++) {
+		memcpy(id, table[i].prefix, HEXXID);
+		assert(lookup_bloom(&id[0], table[i].len, filter) ==
+				table[i].nexthop);
+		assert(lookup_bloom_bsearch(&id[0], table[i].len, filter) ==
+				table[i].nexthop);
+	}
+	radix_destroy_fib(fib);
+	bloom_destroy_fib(filter);
+	free(id);
+	free(left);
+	return 0;
+}
+
+/*
+ * Move the nodes of fib into every layout in turn and compare the lookups of
+ * ids[0..n-1] in each of them with the layout fib was built in
+ */
+static int radix_layout_experiment(struct routtablerec *fib, const xid *ids,
+		unsigned long n)
+{
+	const int layouts[] = {RADIX_LAYOUT_DFS, RADIX_LAYOUT_BFS,
+		RADIX_LAYOUT_VEB};
+	unsigned int *nexthops = malloc(sizeof(unsigned int) * n);
+	unsigned long j;
+	int i;
+
+	for (j = 0; j < n; j++)
+		nexthops[j] = lookup_radix(&ids[j], fib, 0);
+	for (i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+		assert(0 == radix_layout(fib, layouts[i]));
+		for (j = 0; j < n; j++)
+			assert(lookup_radix(&ids[j], fib, 0) == nexthops[j]);
+	}
+	free(nexthops);
+	return 0;
+}
+
+static int correctness_experiment(int exp, uint32_t *seeds, int low,
+							int seedsize)
+{
+	int i, j;
+	unsigned long size = 1 << exp, nbrute;
 	struct nextcreate *table = NULL;
 	struct nextcreate *tmp_table = NULL;
 	int nnexthops = 16;
 	unsigned int len;
-	int nexthops[3] = {0};
+	int nexthops[5 + NSTRIDES] = {0};
 	xid *id1 = alloca(sizeof(xid));
 	unsigned char (*id2)[HEXXID] = calloc(HEXXID, sizeof(unsigned char));
+	unsigned char (*query)[HEXXID];
+	xid *ids = malloc(sizeof(xid) * 3 * size);
 
 	table = malloc(sizeof(struct nextcreate) * size);
 	tmp_table = malloc(sizeof(struct nextcreate) * size);
@@ -44,6 +463,11 @@ static int correctness_experiment(int exp, uint32_t *seeds, int low,
 	memcpy(tmp_table, table, sizeof(struct nextcreate) * size);
 	// Create bloom
 	struct bloom_structure *filter = bloom_create_fib(table, size, BLOOMERRORRATE);
+	assert(0 == bloom_bsearch_build(filter));
+	struct radix_mbtable *mbfib[NSTRIDES];
+	for (j = 0; j < NSTRIDES; j++)
+		mbfib[j] = radix_mb_create_fib(table, size, strides[j]);
+	struct radix_lptable *lpfib = radix_lp_create_fib(table, size);
 	// Create radix
 	// Radix changes original data hence at the end
 	struct routtablerec *fib = radix_create_fib(table, size);
@@ -54,14 +478,49 @@ static int correctness_experiment(int exp, uint32_t *seeds, int low,
 		nexthops[0] = tmp_table[i].nexthop;
 		nexthops[1] = lookup_radix(id1, fib, 0);	// radix lookup
 		nexthops[2] = lookup_bloom(&id2[0], len, filter);// bloom lookup
-		assert((nexthops[0] == nexthops[1]) && (nexthops[1] == nexthops[2]));
+		nexthops[3] = lookup_bloom_bsearch(&id2[0], len, filter);
+		nexthops[4] = lookup_radix_lp(id1, lpfib, 0);
+		for (j = 0; j < NSTRIDES; j++)
+			nexthops[5 + j] = lookup_radix_mb(id1, mbfib[j], 0);
+		for (j = 1; j < 5 + NSTRIDES; j++)
+			assert(nexthops[j] == nexthops[0]);
+	}
+	// The routes followed by as many random XIDs and as many routes with
+	// a bit flipped, which every engine must look up alike, and so must
+	// a brute force search every nbrute of them
+	for (i = 0; i < size; i++)
+		memcpy(&ids[i], tmp_table[i].prefix, HEXXID);
+	randomxids(seeds[low + QUERYSEED], &ids[size], size);
+	perturbxids(seeds[low + PERTURBSEED], tmp_table, size, &ids[2 * size]);
+	nbrute = 3 * size * size / BRUTEWORK + 1;
+	for (i = 0; i < 3 * size; i++) {
+		query = (unsigned char (*)[HEXXID]) &ids[i];
+		nexthops[0] = lookup_radix(&ids[i], fib, 0);
+		nexthops[1] = lookup_bloom(query, HEXXID * BYTE, filter);
+		nexthops[2] = lookup_bloom_bsearch(query, HEXXID * BYTE, filter);
+		nexthops[3] = lookup_radix_lp(&ids[i], lpfib, 0);
+		for (j = 0; j < NSTRIDES; j++)
+			nexthops[4 + j] = lookup_radix_mb(&ids[i], mbfib[j], 0);
+		for (j = 1; j < 4 + NSTRIDES; j++)
+			assert(nexthops[j] == nexthops[0]);
+		if (0 == i % nbrute)
+			assert(nexthops[0] == bruteforce(&ids[i], tmp_table,
+						size));
 	}
+	assert(0 == radix_layout_experiment(fib, ids, 3 * size));
+	for (j = 0; j < NSTRIDES; j++)
+		radix_mb_destroy_fib(mbfib[j]);
+	radix_lp_destroy_fib(lpfib);
+	assert(0 == radix_update_experiment(tmp_table, size));
+	assert(0 == bloom_update_experiment(tmp_table, size));
+	free(ids);
 	free(id2);
 	free(tmp_table);
 	free(table);
 
 	return 0;
 }
+#endif
 
 int main(int argc, char *argv[])
 {
@@ -88,7 +547,7 @@ int main(int argc, char *argv[])
 		// This is taken as a constant for the number of 
 		assert(0 == correctness_experiment(i, seeds, low, seedsize));
 		printf("Done 2^%d\n", i);
-		low = low + NEXTSEED;
+		low = low + PERTURBSEED + 1;
 		assert(low < seedsize);
 	}
 
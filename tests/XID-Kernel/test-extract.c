@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../XID-Kernel/xid_kernel.h"
+
+#define MAXENTRIES 50000
+
+typedef struct extractrec *extractrec_t;
+struct extractrec
+{
+	xid data;
+	int pos;
+	int len;
+};
+
+static int readrecords(char *file_name, extractrec_t rec[], int maxsize);
+static unsigned char hextochar(char a, char b);
+
+int main(int argc, char *argv[])
+{
+	static extractrec_t rec[MAXENTRIES];
+	int nrec, i, j;
+	xid tmp;
+
+	if ((nrec = readrecords(argv[1], rec, MAXENTRIES)) < 0)
+	{
+		fprintf(stderr, "Input file too large.\n");
+		return 1;
+	}
+
+	for (i = 0; i < nrec; i++)
+	{
+		tmp = extract(rec[i]->pos, rec[i]->len, rec[i]->data);
+		for (j = 0; j < XID_BYTES; j++)
+			printf("%02x", tmp.w[j]);
+		printf("\n");
+	}
+	return 0;
+}
+
+static unsigned char hextochar(char a, char b)
+{
+	unsigned char hn, ln;
+
+	hn = a > '9' ? a - 'a' + 10 : a - '0';
+	ln = b > '9' ? b - 'a' + 10 : b - '0';
+	return ((hn << 4 ) | ln);
+}
+
+static int readrecords(char *file_name, extractrec_t rec[], int maxsize)
+{
+	int nrec = 0;
+	FILE *in_file;
+
+	// Auxiliary variables
+	char tmp_data[41] = {0};
+	int loop, len, pos;
+
+	if (!(in_file = fopen(file_name, "rb")))
+	{
+		perror(file_name);
+		exit(-1);
+	}
+
+	while (fscanf(in_file, "%40s%d%d", tmp_data, &len, &pos) != EOF)
+	{
+		if (nrec >= maxsize) return -1;
+		rec[nrec] = (extractrec_t) malloc(sizeof(struct extractrec));
+
+		for (loop = 0; loop < XID_BYTES; loop++)
+			rec[nrec]->data.w[loop] =
+				hextochar(tmp_data[2 * loop], tmp_data[2 * loop + 1]);
+		rec[nrec]->len = len;
+		rec[nrec]->pos = pos;
+		nrec++;
+	}
+	fclose(in_file);
+	return nrec;
+}
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../XID-Kernel/xid_kernel.h"
+
+#define MAXENTRIES 50000
+
+typedef struct lcprec *lcprec_t;
+struct lcprec
+{
+	xid a;
+	xid b;
+};
+
+static int readrecords(char *file_name, lcprec_t rec[], int maxsize);
+static unsigned char hextochar(char a, char b);
+
+int main(int argc, char *argv[])
+{
+	static lcprec_t rec[MAXENTRIES];
+	int nrec, i;
+
+	if ((nrec = readrecords(argv[1], rec, MAXENTRIES)) < 0)
+	{
+		fprintf(stderr, "Input file too large.\n");
+		return 1;
+	}
+
+	for (i = 0; i < nrec; i++)
+	{
+		printf("%d\n", xid_lcp(&rec[i]->a, &rec[i]->b));
+	}
+	return 0;
+}
+
+static unsigned char hextochar(char a, char b)
+{
+	unsigned char hn, ln;
+
+	hn = a > '9' ? a - 'a' + 10 : a - '0';
+	ln = b > '9' ? b - 'a' + 10 : b - '0';
+	return ((hn << 4 ) | ln);
+}
+
+static int readrecords(char *file_name, lcprec_t rec[], int maxsize)
+{
+	int nrec = 0;
+	FILE *in_file;
+
+	// Auxiliary variables
+	char tmp_a[41] = {0};
+	char tmp_b[41] = {0};
+	int loop;
+
+	if (!(in_file = fopen(file_name, "rb")))
+	{
+		perror(file_name);
+		exit(-1);
+	}
+
+	while (fscanf(in_file, "%40s%40s", tmp_a, tmp_b) != EOF)
+	{
+		if (nrec >= maxsize) return -1;
+		rec[nrec] = (lcprec_t) malloc(sizeof(struct lcprec));
+
+		for (loop = 0; loop < XID_BYTES; loop++) {
+			rec[nrec]->a.w[loop] =
+				hextochar(tmp_a[2 * loop], tmp_a[2 * loop + 1]);
+			rec[nrec]->b.w[loop] =
+				hextochar(tmp_b[2 * loop], tmp_b[2 * loop + 1]);
+		}
+		nrec++;
+	}
+	fclose(in_file);
+	return nrec;
+}
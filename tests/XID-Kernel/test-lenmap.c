@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../../XID-Kernel/xid_kernel.h"
+
+#define MAXENTRIES 50000
+
+typedef struct lenmaprec *lenmaprec_t;
+struct lenmaprec
+{
+	uint64_t map[XID_LENMAP_WORDS];
+	int lcp;
+};
+
+static int readrecords(char *file_name, lenmaprec_t rec[], int maxsize);
+
+int main(int argc, char *argv[])
+{
+	static lenmaprec_t rec[MAXENTRIES];
+	int nrec, i;
+
+	if ((nrec = readrecords(argv[1], rec, MAXENTRIES)) < 0)
+	{
+		fprintf(stderr, "Input file too large.\n");
+		return 1;
+	}
+
+	for (i = 0; i < nrec; i++)
+	{
+		printf("%d\n", xid_lenmap_rank(rec[i]->map, rec[i]->lcp));
+	}
+	return 0;
+}
+
+static int readrecords(char *file_name, lenmaprec_t rec[], int maxsize)
+{
+	int nrec = 0;
+	FILE *in_file;
+
+	// Auxiliary variables
+	int nlens, len;
+	int loop;
+
+	if (!(in_file = fopen(file_name, "rb")))
+	{
+		perror(file_name);
+		exit(-1);
+	}
+
+	while (fscanf(in_file, "%d", &nlens) == 1)
+	{
+		if (nrec >= maxsize) return -1;
+		rec[nrec] = (lenmaprec_t) calloc(1, sizeof(struct lenmaprec));
+
+		for (loop = 0; loop < nlens; loop++) {
+			if (fscanf(in_file, "%d", &len) != 1)
+				exit(-1);
+			xid_lenmap_set(rec[nrec]->map, len);
+		}
+		if (fscanf(in_file, "%d", &rec[nrec]->lcp) != 1)
+			exit(-1);
+		nrec++;
+	}
+	fclose(in_file);
+	return nrec;
+}
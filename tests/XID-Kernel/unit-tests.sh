@@ -0,0 +1,59 @@
+#!/bin/bash
+
+# This is a script that compiles the unit tests of the XID primitives shared by
+# all the LPM engines, runs them and compares them with the expected outputs to
+# check if they failed or passed.
+#
+# The naming of the Input (.inp), Compare (.cmp) and Output (.out) files is
+# the same as in tests/LC-Trie/unit-tests.sh
+#
+# File Formats (This is the format of each line of the files)
+# ============
+# 1) test-shift-left.c
+#    I: xid (space) shifts
+#    C: xid
+#
+# 2) test-shift-right.c
+#    I: xid (space) shifts
+#    C: xid
+#
+# 3) test-remove.c
+#    I: xid (space) bits
+#    C: xid
+#
+# 4) test-extract.c
+#    I: xid (space) length (space) pos
+#    C: xid
+#
+# 5) test-bits-u32.c
+#    I: xid (space) length (space) pos
+#    C: 32-bit integer in hexadecimal
+#
+# 6) test-lcp.c
+#    I: xid (space) xid
+#    C: length of the longest common prefix in bits
+#
+# 7) test-lenmap.c
+#    I: number of lengths (space) lengths (space) lcp
+#    C: number of the lengths not longer than lcp
+
+
+declare -a arr=("test-shift-left" "test-shift-right" "test-remove"
+"test-extract" "test-bits-u32" "test-lcp" "test-lenmap")
+
+for i in "${arr[@]}"
+do
+	gcc -w "$i".c ../../XID-Kernel/xid_kernel.c -o "$i"
+done
+
+for i in "${arr[@]}"
+do
+	./"$i" "$i".inp > "$i".out
+	if diff "$i".out "$i".cmp > /dev/null;
+	then
+		echo "$i" Passed
+	else
+		rm "$i".out
+		echo "$i" Failed
+	fi
+done